@@ -0,0 +1,63 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <stdio.h>
+
+#ifndef RA2D_HOST
+
+#include <pspiofilemgr.h>
+
+// is there a flush..? or the non async version always syncs?
+#define DEBUG 1
+#if DEBUG
+extern int logfd;
+#define LOG(...) \
+if(logfd > 0){ \
+	char logbuf[128]; \
+	int loglen = sprintf(logbuf, __VA_ARGS__); \
+	if(loglen > 0){ \
+		sceIoWrite(logfd, logbuf, loglen); \
+	} \
+}
+#else // DEBUG
+#define LOG(...)
+#endif // DEBUG
+
+#else // RA2D_HOST
+
+// host tools sharing the config code log to stderr, the fuzzer and benchmarks that call in a loop build with RA2D_NO_LOG
+#define DEBUG 1
+#ifndef RA2D_NO_LOG
+#define LOG(...) fprintf(stderr, __VA_ARGS__);
+#else // RA2D_NO_LOG
+#define LOG(...)
+#endif // RA2D_NO_LOG
+
+#endif // RA2D_HOST
+
+#define VERBOSE 0
+#if VERBOSE
+#define LOG_VERBOSE(...) LOG(__VA_ARGS__)
+#else // VERBOSE
+#define LOG_VERBOSE(...)
+#endif // VERBOSE
+
+#endif
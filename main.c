@@ -21,6 +21,7 @@
 #include <pspkernel.h>
 #include <pspctrl.h>
 #include <pspiofilemgr.h>
+#include <pspinit.h>
 #include <pspthreadman.h>
 
 #include <stdio.h>
@@ -29,343 +30,559 @@
 
 #include <systemctrl.h>
 
+#include "log.h"
+#include "mapping.h"
+#include "profile.h"
+#include "profile_db.h"
+#include "sfo.h"
+
 #define MODULE_NAME "ra2d"
 
 PSP_MODULE_INFO(MODULE_NAME, 0x1007, 1, 0);
 
-int sceKernelQuerySystemCall(void *function);
-
 #define EMULATOR_DEVCTL__IS_EMULATOR     0x00000003
 
 static STMOD_HANDLER previous;
 
 static int is_emulator;
 
-static u32 MakeSyscallStub(void *function) {
-  SceUID block_id = sceKernelAllocPartitionMemory(PSP_MEMORY_PARTITION_USER, "", PSP_SMEM_High, 2 * sizeof(u32), NULL);
-  u32 stub = (u32)sceKernelGetBlockHeadAddr(block_id);
-  _sw(0x03E00008, stub);
-  _sw(0x0000000C | (sceKernelQuerySystemCall(function) << 6), stub + 4);
-  return stub;
-}
-
-// to be set by config
-static unsigned int yp_btn = PSP_CTRL_SQUARE;
-static unsigned int yn_btn = PSP_CTRL_CROSS;
-static unsigned int xp_btn = 0;
-static unsigned int xn_btn = 0;
-static unsigned char outer_deadzone = 20;
-static unsigned char inner_deadzone = 10;
-
-static u32 window = 8; // frame
-static int algo = 0;
-static u32 min_percent = 0;
-
-// is there a flush..? or the non async version always syncs?
-#define DEBUG 1
 #if DEBUG
-static int logfd;
-#define LOG(...) \
-if(logfd > 0){ \
-	char logbuf[128]; \
-	int loglen = sprintf(logbuf, __VA_ARGS__); \
-	if(loglen > 0){ \
-		sceIoWrite(logfd, logbuf, loglen); \
-	} \
-}
-#else // DEBUG
-#define LOG(...)
+int logfd;
 #endif // DEBUG
-#define VERBOSE 0
-#if VERBOSE
-#define LOG_VERBOSE(...) LOG(__VA_ARGS__)
-#else // VERBOSE
-#define LOG_VERBOSE(...)
-#endif // VERBOSE
 
 
-#define MAKE_JUMP(a, f) _sw(0x08000000 | (((u32)(f) & 0x0FFFFFFC) >> 2), a);
+// every code word patched during a hooking pass is recorded, so that only those ranges get written back and invalidated
+// once the pass is done, and passes that patched nothing leave the caches alone
+#define MAX_PATCH_RANGES 16
+struct patch_range{
+	u32 addr;
+	u32 size;
+};
+struct patch_transaction{
+	struct patch_range ranges[MAX_PATCH_RANGES];
+	int cnt;
+	int overflow;
+};
 
-#define GET_JUMP_TARGET(x) (0x80000000 | (((x) & 0x03FFFFFF) << 2))
+static void patch_transaction_begin(struct patch_transaction *txn){
+	txn->cnt = 0;
+	txn->overflow = 0;
+}
 
-// jacking JR_SYSCALL in ppsspp, so just save the two instructions, instead of seeking the target
-// also scan other modules for the same pattern and patch them if ppsspp
-// for real hw, go the jump target then attempt the more standard two instructions hijack
-// hopefully works with the static args loaded sceCtrl functions, at least referencing uofw and joysens
-#define HIJACK_SYSCALL_STUB(a, f, ptr) \
-do{ \
-  LOG("hijacking jmp function at 0x%lx with 0x%lx\n", (u32)a, (u32)f); \
-  u32 _func_ = (u32)a; \
-  LOG("original instructions: 0x%lx 0x%lx\n", _lw(_func_), _lw(_func_ + 4)); \
-  u32 pattern[2]; \
-  _sw(_lw(_func_), (u32)pattern); \
-  _sw(_lw(_func_ + 4), (u32)pattern + 4); \
-  u32 ff = (u32)f; \
-  if(!is_emulator){ \
-    ff = MakeSyscallStub(f); \
-    _func_ = GET_JUMP_TARGET(_lw(a)); \
-    LOG("real hardware mode, making syscall stub 0x%lx and retargetting function 0x%lx\n", ff, _func_); \
-    LOG("original instructions: 0x%lx 0x%lx\n", _lw(_func_), _lw(_func_ + 4)); \
-  } \
-  static u32 patch_buffer[3]; \
-  u32 patch_draft[2]; \
-  _sw(0x08000000 | (((u32)(ff) >> 2) & 0x03FFFFFF), (u32)patch_draft); \
-  _sw(0, (u32)patch_draft + 4); \
-  if(is_emulator){ \
-    if(_lw(_func_) == _lw((u32)patch_draft) && _lw(_func_ + 4) == _lw((u32)patch_draft + 4)){ \
-      break; \
-    } \
-    _sw(_lw(_func_), (u32)patch_buffer); \
-    _sw(_lw(_func_ + 4), (u32)patch_buffer + 4); \
-  }else{ \
-    _sw(_lw(_func_), (u32)patch_buffer); \
-    _sw(_lw(_func_ + 4), (u32)patch_buffer + 8); \
-    MAKE_JUMP((u32)patch_buffer + 4, _func_ + 8); \
-  } \
-  _sw(_lw((u32)patch_draft), _func_); \
-  _sw(_lw((u32)patch_draft + 4), _func_ + 4); \
-  ptr = (void *)patch_buffer; \
-  if(is_emulator){ \
-    SceUID modules[32]; \
-    SceKernelModuleInfo info; \
-    int i, count = 0; \
-    if (sceKernelGetModuleIdList(modules, sizeof(modules), &count) >= 0) { \
-      for (i = 0; i < count; i++) { \
-        info.size = sizeof(SceKernelModuleInfo); \
-        if (sceKernelQueryModuleInfo(modules[i], &info) < 0) { \
-          continue; \
-        } \
-        if (strcmp(info.name, MODULE_NAME) == 0) { \
-          continue; \
-        } \
-        LOG("scanning module %s in ppsspp mode\n", info.name); \
-        LOG("info.text_addr: 0x%x info.text_size: 0x%x info.nsegment: 0x%x\n", info.text_addr, info.text_size, (int)info.nsegment); \
-        u32 j; \
-        for(j = 0;j < info.nsegment; j++){ \
-          LOG("info.segmentaddr[%ld]: 0x%x info.segmentsize[%ld]: 0x%x\n", j, info.segmentaddr[j], j, info.segmentsize[j]); \
-        } \
-        if(info.text_size == 0){ \
-          if(info.nsegment >= 1 && info.segmentaddr[0] == info.text_addr){ \
-            info.text_size = info.segmentsize[0]; \
-          } \
-        } \
-        u32 k; \
-        for(k = 0; k < info.text_size; k+=4){ \
-          u32 addr = k + info.text_addr; \
-          if(/*_lw((u32)pattern) == _lw(addr + 0) &&*/ _lw((u32)pattern + 4) == _lw(addr + 4)){ \
-            LOG("found instruction pattern 0x%lx 0x%lx at 0x%lx, patching\n", pattern[0], pattern[1], addr); \
-            _sw(0x08000000 | (((u32)(ff) >> 2) & 0x03FFFFFF), addr); \
-            _sw(0, addr + 4); \
-          } \
-        } \
-      } \
-    } \
-  } \
-} while(0);
-
-#define CONV_LE(addr, dest) { \
-	dest = addr[0] | addr[1] << 8 | addr[2] << 16 | addr[3] << 24; \
-}
-
-#define CONV_LE16(addr, dest) { \
-	dest = addr[0] | addr[1] << 8; \
-}
-
-static int get_disc_id(char *out_buf){
-	char *sfo_path = "disc0:/PSP_GAME/PARAM.SFO";
-	int fd = sceIoOpen(sfo_path, PSP_O_RDONLY,0);
-	if(fd <= 0){
-		LOG("cannot open %s for reading\n", sfo_path);
-		return -1;
+static void patch_transaction_record(struct patch_transaction *txn, u32 addr, u32 size){
+	if(txn->cnt == MAX_PATCH_RANGES){
+		txn->overflow = 1;
+		return;
 	}
+	txn->ranges[txn->cnt].addr = addr;
+	txn->ranges[txn->cnt].size = size;
+	txn->cnt++;
+}
 
-	sceIoLseek(fd, 0x08, PSP_SEEK_SET);
-	unsigned char buf[4];
-	if(sceIoRead(fd, &buf, 4) != 4){
-		sceIoClose(fd);
-		LOG("failed reading key table start from sfo\n");
-		return -1;
+// overlays reloaded over patched stubs bring the original stub back, so every patched site is remembered together with
+// what it held before and gets checked a few sites at a time by patch_watchdog_tick()
+#define MAX_PATCH_SITES 128
+#define WATCHDOG_SITES_PER_TICK 16
+struct patch_site{
+	u32 addr;
+	u32 orig[2];
+	u32 jump;
+};
+static struct patch_site patch_sites[MAX_PATCH_SITES];
+static int patch_site_cnt = 0;
+static int patch_watchdog_cursor = 0;
+static u32 repatch_cnt = 0;
+
+static void watch_patch_site(u32 addr, u32 orig0, u32 orig1, u32 jump){
+	if(patch_site_cnt == MAX_PATCH_SITES){
+		LOG_VERBOSE("patch site registry is full, not watching 0x%lx\n", addr);
+		return;
 	}
-	u32 key_table_start = 0;
-	CONV_LE(buf, key_table_start);
-	LOG_VERBOSE("key_table_start is %ld\n", key_table_start);
+	struct patch_site *site = &patch_sites[patch_site_cnt];
+	site->addr = addr;
+	site->orig[0] = orig0;
+	site->orig[1] = orig1;
+	site->jump = jump;
+	patch_site_cnt++;
+}
 
-	if(sceIoRead(fd, &buf, 4) != 4){
-		sceIoClose(fd);
-		LOG("failed reading data table start from sfo\n");
-		return -1;
-	}
-	u32 data_table_start = 0;
-	CONV_LE(buf, data_table_start);
-	LOG_VERBOSE("data_table_start is %ld\n", data_table_start);
+// j target + nop
+static void patch_transaction_jump(struct patch_transaction *txn, u32 addr, u32 target){
+	u32 jump = 0x08000000 | ((target >> 2) & 0x03FFFFFF);
+	watch_patch_site(addr, _lw(addr), _lw(addr + 4), jump);
+	_sw(jump, addr);
+	_sw(0, addr + 4);
+	patch_transaction_record(txn, addr, 2 * sizeof(u32));
+}
 
-	if(sceIoRead(fd, &buf, 4) != 4){
-		sceIoClose(fd);
-		LOG("failed reading tables entries from sfo\n");
-		return -1;
+static void patch_watchdog_tick(struct patch_transaction *txn){
+	int i;
+	for(i = 0;i < WATCHDOG_SITES_PER_TICK && i < patch_site_cnt;i++){
+		struct patch_site *site = &patch_sites[patch_watchdog_cursor];
+		patch_watchdog_cursor = (patch_watchdog_cursor + 1) % patch_site_cnt;
+		if(site->addr == 0){
+			continue;
+		}
+		u32 word0 = _lw(site->addr);
+		u32 word1 = _lw(site->addr + 4);
+		if(word0 == site->jump && word1 == 0){
+			continue;
+		}
+		if(word0 != site->orig[0] || word1 != site->orig[1]){
+			// something else lives there now, patching it would corrupt it
+			LOG("patch site 0x%lx got overwritten with 0x%lx 0x%lx, no longer watching it\n", site->addr, word0, word1);
+			site->addr = 0;
+			continue;
+		}
+		_sw(site->jump, site->addr);
+		_sw(0, site->addr + 4);
+		patch_transaction_record(txn, site->addr, 2 * sizeof(u32));
+		repatch_cnt++;
+		LOG("patch site 0x%lx got reverted, repatched, %ld repatches so far\n", site->addr, repatch_cnt);
 	}
-	u32 tables_entries = 0;
-	CONV_LE(buf, tables_entries);
-	LOG_VERBOSE("tables_entries is %ld\n", tables_entries);
+}
 
+static void patch_transaction_commit(struct patch_transaction *txn){
+	if(txn->overflow){
+		LOG_VERBOSE("more than %d patched ranges, flushing whole caches\n", MAX_PATCH_RANGES);
+		sceKernelDcacheWritebackAll();
+		sceKernelIcacheClearAll();
+		return;
+	}
 	int i;
-	for(i = 0;i < tables_entries;i++){
-		sceIoLseek(fd, 0x14 + i * 0x10, PSP_SEEK_SET);
-		if(sceIoRead(fd, &buf, 2) != 2){
-			sceIoClose(fd);
-			LOG("failed reading key offset from sfo\n");
-			return -1;
-		}
-		u32 key_offset = 0;
-		CONV_LE16(buf, key_offset);
+	for(i = 0;i < txn->cnt;i++){
+		sceKernelDcacheWritebackRange((void *)txn->ranges[i].addr, txn->ranges[i].size);
+		sceKernelIcacheInvalidateRange((void *)txn->ranges[i].addr, txn->ranges[i].size);
+	}
+}
 
-		if(sceIoRead(fd, &buf, 2) != 2){
-			sceIoClose(fd);
-			LOG("failed reading data format from sfo\n");
-			return -1;
-		}
-		u32 data_format = 0;
-		CONV_LE16(buf, data_format);
+// real hw resolves the controller functions straight from the controller service by nid and redirects their syscalls
+#define SCE_CTRL_MODULE "sceController_Service"
+#define SCE_CTRL_LIBRARY "sceCtrl"
+#define SCE_CTRL_READ_BUFFER_POSITIVE_NID 0x1F803938
+#define SCE_CTRL_READ_BUFFER_NEGATIVE_NID 0x60B81F86
+#define SCE_CTRL_PEEK_BUFFER_POSITIVE_NID 0x3A622550
+#define SCE_CTRL_PEEK_BUFFER_NEGATIVE_NID 0xC152080A
+#define SCE_CTRL_READ_LATCH_NID 0x0B588501
+#define SCE_CTRL_PEEK_LATCH_NID 0xB1D0E5CD
+// the extended reads are not in the sdk's stubs, so they are only hooked on real hw, where the nid is all it takes
+#define SCE_CTRL_READ_BUFFER_POSITIVE_2_NID 0x1098030B
+#define SCE_CTRL_READ_BUFFER_NEGATIVE_2_NID 0x7C3675AB
+#define SCE_CTRL_PEEK_BUFFER_POSITIVE_2_NID 0x5A36B1C2
+#define SCE_CTRL_PEEK_BUFFER_NEGATIVE_2_NID 0x239A6BA7
 
-		if(sceIoRead(fd, &buf, 4) != 4){
-			sceIoClose(fd);
-			LOG("failed reading data len from sfo\n");
-			return -1;
-		}
-		u32 data_len = 0;
-		CONV_LE(buf, data_len);
+#define GET_JUMP_TARGET(x) (0x80000000 | (((x) & 0x03FFFFFF) << 2))
+
+// moves a buffer into a bigger kernel partition block, the initial static buffer is never freed
+static void *grow_buffer(SceUID *block_id, void *buf, u32 used_size, u32 new_size){
+	SceUID new_block_id = sceKernelAllocPartitionMemory(PSP_MEMORY_PARTITION_KERNEL, MODULE_NAME, PSP_SMEM_Low, new_size, NULL);
+	if(new_block_id < 0){
+		LOG("failed allocating 0x%lx bytes, 0x%x\n", new_size, new_block_id);
+		return NULL;
+	}
+	void *new_buf = sceKernelGetBlockHeadAddr(new_block_id);
+	memcpy(new_buf, buf, used_size);
+	if(*block_id >= 0){
+		sceKernelFreePartitionMemory(*block_id);
+	}
+	*block_id = new_block_id;
+	return new_buf;
+}
+
+// the main thread's hooking passes and the module start hook both walk the module list and the scan registry below,
+// and either may move them into a bigger block, so scanning and patching is done under this lock
+static SceUID scan_sema = -1;
+
+static void scan_lock(){
+	sceKernelWaitSema(scan_sema, 1, NULL);
+}
+
+static void scan_unlock(){
+	sceKernelSignalSema(scan_sema, 1);
+}
 
-		sceIoLseek(fd, 4, PSP_SEEK_CUR);
-		if(sceIoRead(fd, &buf, 4) != 4){
-			sceIoClose(fd);
-			LOG("failed reading data offset from sfo\n");
+// the module id list is reused across passes and only grows when there are more modules than it can hold, returns 1
+// when growing failed and only part of the list was read
+#define INITIAL_MODULE_IDS 64
+static SceUID initial_module_ids[INITIAL_MODULE_IDS];
+static SceUID *module_ids = initial_module_ids;
+static int module_id_cap = INITIAL_MODULE_IDS;
+static SceUID module_ids_block_id = -1;
+
+static int list_modules(int *count){
+	while(1){
+		if(sceKernelGetModuleIdList(module_ids, module_id_cap * sizeof(SceUID), count) < 0){
 			return -1;
 		}
-		u32 data_offset = 0;
-		CONV_LE(buf, data_offset);
+		if(*count <= module_id_cap){
+			return 0;
+		}
+		// the count is the total number of modules, get room for all of them and a few more then ask again
+		int new_cap = *count + 16;
+		SceUID *new_module_ids = grow_buffer(&module_ids_block_id, module_ids, 0, new_cap * sizeof(SceUID));
+		if(new_module_ids == NULL){
+			*count = module_id_cap;
+			return 1;
+		}
+		LOG("growing module id list to %d entries\n", new_cap);
+		module_ids = new_module_ids;
+		module_id_cap = new_cap;
+	}
+}
 
-		sceIoLseek(fd, key_offset + key_table_start, PSP_SEEK_SET);
-		char keybuf[50];
-		int j;
-		for(j = 0;j < 50;j++){
-			if(sceIoRead(fd, &keybuf[j], 1) != 1){
-				sceIoClose(fd);
-				LOG("failed reading key from sfo\n");
-			}
-			if(keybuf[j] == 0){
-				break;
+// modules already scanned for stubs in ppsspp mode, so each pass only walks the text of newly loaded modules
+#define INITIAL_SCANNED_MODULES 64
+struct scanned_module{
+	SceUID uid;
+	u32 text_addr;
+	u32 text_size;
+};
+static struct scanned_module initial_scanned_modules[INITIAL_SCANNED_MODULES];
+static struct scanned_module *scanned_modules = initial_scanned_modules;
+static int scanned_module_cap = INITIAL_SCANNED_MODULES;
+static SceUID scanned_modules_block_id = -1;
+static int scanned_module_cnt = 0;
+static u32 scan_pass = 0;
+static u32 scan_words = 0;
+
+static int text_overlaps(struct scanned_module *mod, u32 text_addr, u32 text_size){
+	return mod->text_addr < text_addr + text_size && text_addr < mod->text_addr + mod->text_size;
+}
+
+static void drop_scanned_module(int i){
+	scanned_module_cnt--;
+	scanned_modules[i] = scanned_modules[scanned_module_cnt];
+}
+
+static int module_needs_scan(SceUID uid, u32 text_addr, u32 text_size){
+	int i;
+	for(i = 0;i < scanned_module_cnt;i++){
+		struct scanned_module *mod = &scanned_modules[i];
+		if(mod->uid != uid){
+			// live modules never share text, so an entry under the new module's text is one that got unloaded, its
+			// slot is freed even when no listing pass runs anymore to prune it
+			if(text_size != 0 && text_overlaps(mod, text_addr, text_size)){
+				drop_scanned_module(i);
+				i--;
 			}
+			continue;
+		}
+		if(mod->text_addr != text_addr || mod->text_size != text_size){
+			// uid got reused by a different module
+			mod->text_addr = text_addr;
+			mod->text_size = text_size;
+			return 1;
+		}
+		return 0;
+	}
+	if(scanned_module_cnt == scanned_module_cap){
+		int new_cap = scanned_module_cap * 2;
+		struct scanned_module *new_scanned_modules = grow_buffer(&scanned_modules_block_id, scanned_modules, scanned_module_cnt * sizeof(struct scanned_module), new_cap * sizeof(struct scanned_module));
+		if(new_scanned_modules == NULL){
+			LOG("scanned module registry is full, always scanning module 0x%x\n", uid);
+			return 1;
 		}
-		LOG_VERBOSE("key is %s\n", keybuf);
+		scanned_modules = new_scanned_modules;
+		scanned_module_cap = new_cap;
+	}
+	struct scanned_module *mod = &scanned_modules[scanned_module_cnt];
+	mod->uid = uid;
+	mod->text_addr = text_addr;
+	mod->text_size = text_size;
+	scanned_module_cnt++;
+	return 1;
+}
 
-		sceIoLseek(fd, data_offset + data_table_start, PSP_SEEK_SET);
-		char databuf[data_len];
-		for(j = 0;j < data_len; j++){
-			if(sceIoRead(fd, &databuf[j], 1) != 1){
-				sceIoClose(fd);
-				LOG("failed reading data from sfo\n");
-			}
+// entries of modules missing from a complete listing were unloaded, dropping them keeps the registry and the lookups
+// above at the size of what is loaded rather than of everything that ever was
+static void prune_scanned_modules(int count){
+	int i;
+	for(i = 0;i < scanned_module_cnt;i++){
+		int j;
+		for(j = 0;j < count && module_ids[j] != scanned_modules[i].uid;j++);
+		if(j == count){
+			drop_scanned_module(i);
+			i--;
 		}
-		if(data_format == 0x0204){
-			LOG_VERBOSE("utf8 data: %s\n", databuf);
-		}else{
-			LOG_VERBOSE("data is not utf8, not printing\n");
+	}
+}
+
+// every hooked stub is a jr ra + syscall pair in ppsspp, so one walk over a module's text matches all of them at once
+// through a small open addressing table keyed on the syscall code
+#define SYSCALL_OPCODE_MASK 0xFC00003F
+#define SYSCALL_OPCODE 0x0000000C
+#define SCAN_TARGET_SLOTS 16
+struct scan_target{
+	u32 syscall_word;
+	u32 jump_target;
+	int hits;
+};
+static struct scan_target scan_targets[SCAN_TARGET_SLOTS];
+
+static inline u32 scan_target_slot(u32 syscall_word){
+	return (syscall_word >> 6) & (SCAN_TARGET_SLOTS - 1);
+}
+
+static void add_scan_target(u32 syscall_word, u32 jump_target){
+	if((syscall_word & SYSCALL_OPCODE_MASK) != SYSCALL_OPCODE){
+		LOG("0x%lx is not a syscall, not scanning for it\n", syscall_word);
+		return;
+	}
+	u32 slot = scan_target_slot(syscall_word);
+	int i;
+	for(i = 0;i < SCAN_TARGET_SLOTS;i++){
+		struct scan_target *target = &scan_targets[slot];
+		if(target->syscall_word == 0 || target->syscall_word == syscall_word){
+			target->syscall_word = syscall_word;
+			target->jump_target = jump_target;
+			target->hits = 0;
+			return;
 		}
+		slot = (slot + 1) & (SCAN_TARGET_SLOTS - 1);
+	}
+	LOG("scan target table is full, not scanning for 0x%lx\n", syscall_word);
+}
 
-		if(strncmp("DISC_ID", keybuf, 8) == 0){
-			strcpy(out_buf, databuf);
-			break;
+// probes at most every slot once, a full table has no empty slot to stop at
+static struct scan_target *find_scan_target(u32 syscall_word){
+	u32 slot = scan_target_slot(syscall_word);
+	int i;
+	for(i = 0;i < SCAN_TARGET_SLOTS && scan_targets[slot].syscall_word != 0;i++){
+		if(scan_targets[slot].syscall_word == syscall_word){
+			return &scan_targets[slot];
 		}
+		slot = (slot + 1) & (SCAN_TARGET_SLOTS - 1);
 	}
+	return NULL;
+}
 
-	sceIoClose(fd);
-	return 0;
+static int scan_target_hits(u32 syscall_word){
+	struct scan_target *target = find_scan_target(syscall_word);
+	return target == NULL ? 0 : target->hits;
 }
 
-static int button_on(int val, u32 timestamp){
-	int max_val = (127 - outer_deadzone) - (inner_deadzone);
-	if(max_val <= 0){
+static void scan_module_text(struct patch_transaction *txn, u32 text_addr, u32 text_size){
+	u32 k;
+	// the syscall is the second instruction of the stub
+	for(k = 4; k < text_size; k+=4){
+		u32 addr = k + text_addr;
+		u32 word = _lw(addr);
+		if((word & SYSCALL_OPCODE_MASK) != SYSCALL_OPCODE){
+			continue;
+		}
+		struct scan_target *target = find_scan_target(word);
+		if(target != NULL){
+			LOG("found instruction pattern 0x%lx 0x%lx at 0x%lx, patching\n", _lw(addr - 4), word, addr - 4);
+			patch_transaction_jump(txn, addr - 4, target->jump_target);
+			target->hits++;
+		}
+	}
+	scan_words += text_size / 4;
+}
+
+// returns whether the module got scanned
+static int scan_module(struct patch_transaction *txn, SceUID uid){
+	SceKernelModuleInfo info;
+	info.size = sizeof(SceKernelModuleInfo);
+	if (sceKernelQueryModuleInfo(uid, &info) < 0) {
 		return 0;
 	}
-	if(val < inner_deadzone){
+	if (strcmp(info.name, MODULE_NAME) == 0) {
 		return 0;
-	}else{
-		val = val - inner_deadzone;
 	}
-	if(val > max_val){
-		val = max_val;
+	if(info.text_size == 0){
+		if(info.nsegment >= 1 && info.segmentaddr[0] == info.text_addr){
+			info.text_size = info.segmentsize[0];
+		}
+	}
+	if(!module_needs_scan(uid, info.text_addr, info.text_size)){
+		return 0;
 	}
+	LOG("scanning module %s in ppsspp mode\n", info.name);
+	LOG("info.text_addr: 0x%x info.text_size: 0x%x info.nsegment: 0x%x\n", info.text_addr, info.text_size, (int)info.nsegment);
+	u32 j;
+	for(j = 0;j < info.nsegment; j++){
+		LOG("info.segmentaddr[%ld]: 0x%x info.segmentsize[%ld]: 0x%x\n", j, info.segmentaddr[j], j, info.segmentsize[j]);
+	}
+	scan_module_text(txn, info.text_addr, info.text_size);
+	return 1;
+}
 
-	u32 min_slice = window * min_percent / 100;
-	if(min_slice == 0){
-		min_slice = 1;
+static void scan_modules(struct patch_transaction *txn){
+	int i, count = 0;
+	int listed = list_modules(&count);
+	if (listed < 0) {
+		return;
+	}
+	if(listed == 0){
+		prune_scanned_modules(count);
 	}
-	u32 slice = min_slice + (val * (window - min_slice)) / max_val;
+	for (i = 0; i < count; i++) {
+		scan_module(txn, module_ids[i]);
+	}
+}
 
-	u32 n = timestamp % window + 1;
-	LOG_VERBOSE("val is %d, w is %ld, n is %ld, slice is %ld\n", val, w, n, slice);
-	switch(algo){
-		case 0:
-			return slice >= n;
-		case 1:
-			int odd_frames = window / 2 + window % 2;
-			int slice_odd = slice > odd_frames ? odd_frames : slice;
-			int slice_even = slice > slice_odd ? slice - slice_odd : 0;
-			if(n % 2 == 0){
-				return slice_even >= n / 2;
-			}else{
-				return slice_odd >= 1 + n / 2;
-			}
-		default:
-			return 0;
+enum hook_flags{
+	HOOK_REQUIRED = 1,
+	HOOK_EMULATOR_ONLY = 2
+};
+
+// one row per hooked function, stub is the plugin's own import stub, nid 0 means no nid lookup on real hw, and a row
+// with no stub is only hooked on real hw
+struct hook{
+	char *name;
+	void *stub;
+	u32 nid;
+	void *patched;
+	void **orig;
+	int flags;
+	u32 patch_buffer[2];
+};
+
+// jacking JR_SYSCALL in ppsspp, so just save the two instructions, instead of seeking the target
+// also register the pattern so scan_modules() patches the same stub in other modules
+static void hijack_syscall_stub(struct patch_transaction *txn, struct hook *hook){
+	LOG("hijacking jmp function %s at 0x%lx with 0x%lx\n", hook->name, (u32)hook->stub, (u32)hook->patched);
+	u32 func = (u32)hook->stub;
+	LOG("original instructions: 0x%lx 0x%lx\n", _lw(func), _lw(func + 4));
+	u32 patch_buffer = (u32)hook->patch_buffer;
+	_sw(_lw(func), patch_buffer);
+	_sw(_lw(func + 4), patch_buffer + 4);
+	// the patch buffer gets executed as the original function
+	patch_transaction_record(txn, patch_buffer, sizeof(hook->patch_buffer));
+	patch_transaction_jump(txn, func, (u32)hook->patched);
+	*hook->orig = (void *)patch_buffer;
+	add_scan_target(_lw(patch_buffer + 4), (u32)hook->patched);
+}
+
+// real hw points the syscall table entry itself at the patched function, so games reach it with no trampoline in
+// between and the original is called directly, the function is resolved by nid when possible so it does not have to
+// be imported, otherwise through the jump target of the plugin's own import stub
+static void redirect_syscall(struct hook *hook){
+	u32 func = 0;
+	if(hook->nid != 0){
+		func = sctrlHENFindFunction(SCE_CTRL_MODULE, SCE_CTRL_LIBRARY, hook->nid);
+		if(func == 0){
+			LOG("cannot find nid 0x%lx in %s, falling back to the import stub\n", hook->nid, SCE_CTRL_LIBRARY);
+		}
+	}
+	if(func == 0){
+		if(hook->stub == NULL){
+			LOG("cannot resolve %s, not hooking it\n", hook->name);
+			return;
+		}
+		func = GET_JUMP_TARGET(_lw((u32)hook->stub));
 	}
+	LOG("redirecting syscall of %s at 0x%lx to 0x%lx\n", hook->name, func, (u32)hook->patched);
+	*hook->orig = (void *)func;
+	sctrlHENPatchSyscall((void *)func, hook->patched);
 }
 
-static void apply_analog_to_digital(SceCtrlData *pad_data, int count, int negative){
-	if(count < 1){
-		LOG("count is %d, processing skipped\n", count);
-		return;
+// image of the start of a PARAM.SFO, anything past MAX_SFO_SIZE is not read
+static unsigned char sfo_buf[MAX_SFO_SIZE];
+
+// one read for the header and index, one more for the key and data tables
+static int get_disc_id_from_disc(char *out_buf, u32 out_size){
+	char *sfo_path = "disc0:/PSP_GAME/PARAM.SFO";
+	int fd = sceIoOpen(sfo_path, PSP_O_RDONLY,0);
+	if(fd <= 0){
+		LOG("cannot open %s for reading\n", sfo_path);
+		return -1;
 	}
 
-	LOG_VERBOSE("processing %d buffers in %s mode\n", count, negative? "negative" : "positive");
+	int index_size = SFO_HEADER_SIZE + MAX_SFO_ENTRIES * SFO_ENTRY_SIZE;
+	int read_len = sceIoRead(fd, sfo_buf, index_size);
+	if(read_len < SFO_HEADER_SIZE){
+		sceIoClose(fd);
+		LOG("failed reading header from sfo\n");
+		return -1;
+	}
 
-	int i;
-	for(i = 0;i < count; i++){
-		int buttons = negative ? ~pad_data[i].Buttons : pad_data[i].Buttons;
-		int rx = pad_data[i].Rsrv[0];
-		int ry = pad_data[i].Rsrv[1];
-		u32 timestamp = pad_data->TimeStamp;
-
-		if(rx > 128){
-			int val = rx - 128;
-			if(button_on(val, timestamp))
-				buttons |= xp_btn;
-		}
-		if(rx < 128){
-			int val = 128 - rx;
-			if(val == 128){
-				val = 127;
-			}
-			if(button_on(val, timestamp))
-				buttons |= xn_btn;
-		}
-		if(ry > 128){
-			int val = ry - 128;
-			if(button_on(val, timestamp))
-				buttons |= yp_btn;
-		}
-		if(ry < 128){
-			int val = 128 - ry;
-			if(val == 128){
-				val = 127;
+	const unsigned char *field = sfo_buf + 0x08;
+	u32 key_table_start = 0;
+	CONV_LE(field, key_table_start);
+	if(key_table_start >= MAX_SFO_SIZE){
+		sceIoClose(fd);
+		LOG("sfo key table starts past %d bytes\n", MAX_SFO_SIZE);
+		return -1;
+	}
+
+	// usually the key table directly follows the index, which is already in the buffer
+	int sfo_len = read_len;
+	if(key_table_start <= read_len){
+		if(read_len == index_size){
+			int tables_len = sceIoRead(fd, sfo_buf + read_len, MAX_SFO_SIZE - read_len);
+			if(tables_len > 0){
+				sfo_len += tables_len;
 			}
-			if(button_on(val, timestamp))
-				buttons |= yn_btn;
 		}
+	}else{
+		sceIoLseek(fd, key_table_start, PSP_SEEK_SET);
+		int tables_len = sceIoRead(fd, sfo_buf + key_table_start, MAX_SFO_SIZE - key_table_start);
+		if(tables_len > 0){
+			sfo_len = key_table_start + tables_len;
+		}
+	}
+	sceIoClose(fd);
+
+	return sfo_find_disc_id(sfo_buf, sfo_len, out_buf, out_size);
+}
+
+#define PBP_HEADER_SIZE 0x28
+
+// eboots carry their PARAM.SFO as the first section, offset at 0x08 and the next section at 0x0C
+static int get_disc_id_from_pbp(const char *pbp_path, char *out_buf, u32 out_size){
+	int fd = sceIoOpen(pbp_path, PSP_O_RDONLY, 0);
+	if(fd <= 0){
+		LOG("cannot open %s for reading\n", pbp_path);
+		return -1;
+	}
 
-		LOG_VERBOSE("timestamp: %d rx: %d ry: %d\n", timestamp, rx, ry);
-		pad_data[i].Buttons = negative ? ~buttons : buttons;
+	unsigned char header[PBP_HEADER_SIZE];
+	if(sceIoRead(fd, header, PBP_HEADER_SIZE) != PBP_HEADER_SIZE || memcmp(header, "\0PBP", 4) != 0){
+		sceIoClose(fd);
+		LOG("%s is not a pbp\n", pbp_path);
+		return -1;
+	}
+
+	const unsigned char *field = header + 0x08;
+	u32 sfo_offset = 0;
+	CONV_LE(field, sfo_offset);
+	field = header + 0x0C;
+	u32 sfo_end = 0;
+	CONV_LE(field, sfo_end);
+	if(sfo_end <= sfo_offset){
+		sceIoClose(fd);
+		LOG("pbp sfo section is empty\n");
+		return -1;
+	}
+
+	u32 sfo_len = sfo_end - sfo_offset;
+	if(sfo_len > MAX_SFO_SIZE){
+		sfo_len = MAX_SFO_SIZE;
+	}
+	sceIoLseek(fd, sfo_offset, PSP_SEEK_SET);
+	int read_len = sceIoRead(fd, sfo_buf, sfo_len);
+	sceIoClose(fd);
+	if(read_len <= 0){
+		LOG("failed reading sfo from %s\n", pbp_path);
+		return -1;
 	}
+
+	return sfo_find_disc_id(sfo_buf, read_len, out_buf, out_size);
+}
+
+// the sdk exposes no title id getter, so go through the executable the kernel booted, then the umd
+static int get_disc_id(char *out_buf, u32 out_size){
+	char *init_file = sceKernelInitFileName();
+	if(init_file != NULL){
+		LOG_VERBOSE("init file is %s\n", init_file);
+		int len = strlen(init_file);
+		if(len > 4 && strcasecmp(init_file + len - 4, ".PBP") == 0 && get_disc_id_from_pbp(init_file, out_buf, out_size) == 0){
+			return 0;
+		}
+	}
+	return get_disc_id_from_disc(out_buf, out_size);
 }
 
 static int (*sceCtrlReadBufferPositiveOrig)(SceCtrlData *pad_data, int count);
@@ -390,37 +607,204 @@ int sceCtrlReadBufferNegativePatched(SceCtrlData *pad_data, int count){
 	return res;
 }
 
+// games often peek several times per frame, a repeated peek of the same samples reuses the already mapped buttons
+// instead of advancing the pattern again, samples are stride bytes apart and the extended peeks also key on the port
+#define PEEK_CACHE_SIZE 16
+struct peek_cache{
+	int port;
+	u32 timestamp;
+	int count;
+	u32 buttons[PEEK_CACHE_SIZE];
+};
+
+#define PEEK_SAMPLE(pad_data, i, stride) ((SceCtrlData *)((char *)(pad_data) + (i) * (stride)))
+
+static int peek_cache_hit(struct peek_cache *cache, int port, SceCtrlData *pad_data, int count, u32 stride){
+	if(count < 1 || count != cache->count || port != cache->port || PEEK_SAMPLE(pad_data, count - 1, stride)->TimeStamp != cache->timestamp){
+		return 0;
+	}
+	int i;
+	for(i = 0;i < count;i++){
+		PEEK_SAMPLE(pad_data, i, stride)->Buttons = cache->buttons[i];
+	}
+	return 1;
+}
+
+static void peek_cache_store(struct peek_cache *cache, int port, SceCtrlData *pad_data, int count, u32 stride){
+	if(count < 1 || count > PEEK_CACHE_SIZE){
+		cache->count = 0;
+		return;
+	}
+	int i;
+	for(i = 0;i < count;i++){
+		cache->buttons[i] = PEEK_SAMPLE(pad_data, i, stride)->Buttons;
+	}
+	cache->port = port;
+	cache->count = count;
+	cache->timestamp = PEEK_SAMPLE(pad_data, count - 1, stride)->TimeStamp;
+}
+
+static struct peek_cache peek_positive_cache;
 static int (*sceCtrlPeekBufferPositiveOrig)(SceCtrlData *pad_data, int count);
 int sceCtrlPeekBufferPositivePatched(SceCtrlData *pad_data, int count){
 	int k1 = pspSdkSetK1(0);
 	int res = sceCtrlPeekBufferPositiveOrig(pad_data, count);
 
-	apply_analog_to_digital(pad_data, res, 0);
+	if(!peek_cache_hit(&peek_positive_cache, 0, pad_data, res, sizeof(SceCtrlData))){
+		apply_analog_to_digital(pad_data, res, 0);
+		peek_cache_store(&peek_positive_cache, 0, pad_data, res, sizeof(SceCtrlData));
+	}
 
 	pspSdkSetK1(k1);
 	return res;
 }
 
+static struct peek_cache peek_negative_cache;
 static int (*sceCtrlPeekBufferNegativeOrig)(SceCtrlData *pad_data, int count);
 int sceCtrlPeekBufferNegativePatched(SceCtrlData *pad_data, int count){
 	int k1 = pspSdkSetK1(0);
 	int res = sceCtrlPeekBufferNegativeOrig(pad_data, count);
 
-	apply_analog_to_digital(pad_data, res, 1);
+	if(!peek_cache_hit(&peek_negative_cache, 0, pad_data, res, sizeof(SceCtrlData))){
+		apply_analog_to_digital(pad_data, res, 1);
+		peek_cache_store(&peek_negative_cache, 0, pad_data, res, sizeof(SceCtrlData));
+	}
+
+	pspSdkSetK1(k1);
+	return res;
+}
+
+// the extended reads take a port, 0 being the psp's own controller, and fill bigger records with the plain sample
+// at their head, so they run through the same kernels with a wider stride
+static int (*sceCtrlReadBufferPositive2Orig)(int port, struct ctrl_data_ext *pad_data, int count);
+int sceCtrlReadBufferPositive2Patched(int port, struct ctrl_data_ext *pad_data, int count){
+	int k1 = pspSdkSetK1(0);
+	int res = sceCtrlReadBufferPositive2Orig(port, pad_data, count);
+
+	apply_analog_to_digital_ext(pad_data, res, 0);
+
+	pspSdkSetK1(k1);
+	return res;
+}
+
+static int (*sceCtrlReadBufferNegative2Orig)(int port, struct ctrl_data_ext *pad_data, int count);
+int sceCtrlReadBufferNegative2Patched(int port, struct ctrl_data_ext *pad_data, int count){
+	int k1 = pspSdkSetK1(0);
+	int res = sceCtrlReadBufferNegative2Orig(port, pad_data, count);
+
+	apply_analog_to_digital_ext(pad_data, res, 1);
+
+	pspSdkSetK1(k1);
+	return res;
+}
+
+static struct peek_cache peek_positive_2_cache;
+static int (*sceCtrlPeekBufferPositive2Orig)(int port, struct ctrl_data_ext *pad_data, int count);
+int sceCtrlPeekBufferPositive2Patched(int port, struct ctrl_data_ext *pad_data, int count){
+	int k1 = pspSdkSetK1(0);
+	int res = sceCtrlPeekBufferPositive2Orig(port, pad_data, count);
+
+	if(!peek_cache_hit(&peek_positive_2_cache, port, &pad_data->data, res, sizeof(struct ctrl_data_ext))){
+		apply_analog_to_digital_ext(pad_data, res, 0);
+		peek_cache_store(&peek_positive_2_cache, port, &pad_data->data, res, sizeof(struct ctrl_data_ext));
+	}
+
+	pspSdkSetK1(k1);
+	return res;
+}
+
+static struct peek_cache peek_negative_2_cache;
+static int (*sceCtrlPeekBufferNegative2Orig)(int port, struct ctrl_data_ext *pad_data, int count);
+int sceCtrlPeekBufferNegative2Patched(int port, struct ctrl_data_ext *pad_data, int count){
+	int k1 = pspSdkSetK1(0);
+	int res = sceCtrlPeekBufferNegative2Orig(port, pad_data, count);
+
+	if(!peek_cache_hit(&peek_negative_2_cache, port, &pad_data->data, res, sizeof(struct ctrl_data_ext))){
+		apply_analog_to_digital_ext(pad_data, res, 1);
+		peek_cache_store(&peek_negative_2_cache, port, &pad_data->data, res, sizeof(struct ctrl_data_ext));
+	}
+
+	pspSdkSetK1(k1);
+	return res;
+}
+
+// latches are derived from the real buttons by the firmware, so make/break/press/release of the injected buttons
+// are worked out from the injected buttons seen by the previous sceCtrlReadLatch
+static u32 latch_prev_injected;
+
+static void apply_analog_to_latch(SceCtrlLatch *latch_data, int consume){
+	if(sceCtrlPeekBufferPositiveOrig == NULL){
+		return;
+	}
+	SceCtrlData pad_data;
+	if(sceCtrlPeekBufferPositiveOrig(&pad_data, 1) < 1){
+		return;
+	}
+	if(pad_data.TimeStamp != last_mapped_timestamp){
+		apply_analog_to_digital(&pad_data, 1, 0);
+	}
+
+	u32 injected = last_injected;
+	latch_data->uiMake |= injected & ~latch_prev_injected;
+	latch_data->uiBreak |= ~injected & latch_prev_injected & ~latch_data->uiPress;
+	latch_data->uiPress |= injected;
+	latch_data->uiRelease &= ~injected;
+	if(consume){
+		latch_prev_injected = injected;
+	}
+}
+
+static int (*sceCtrlReadLatchOrig)(SceCtrlLatch *latch_data);
+int sceCtrlReadLatchPatched(SceCtrlLatch *latch_data){
+	int k1 = pspSdkSetK1(0);
+	int res = sceCtrlReadLatchOrig(latch_data);
+
+	if(res >= 0){
+		apply_analog_to_latch(latch_data, 1);
+	}
+
+	pspSdkSetK1(k1);
+	return res;
+}
+
+static int (*sceCtrlPeekLatchOrig)(SceCtrlLatch *latch_data);
+int sceCtrlPeekLatchPatched(SceCtrlLatch *latch_data){
+	int k1 = pspSdkSetK1(0);
+	int res = sceCtrlPeekLatchOrig(latch_data);
+
+	if(res >= 0){
+		apply_analog_to_latch(latch_data, 0);
+	}
+
+	pspSdkSetK1(k1);
+	return res;
+}
+
+// ppsspp has no start module handler, so the game's own module starting stubs are hooked instead,
+// letting freshly loaded modules get their stubs patched before they run
+static int (*sceKernelStartModuleOrig)(SceUID modid, SceSize argsize, void *argp, int *status, SceKernelSMOption *option);
+int sceKernelStartModulePatched(SceUID modid, SceSize argsize, void *argp, int *status, SceKernelSMOption *option){
+	int k1 = pspSdkSetK1(0);
+	scan_lock();
+	struct patch_transaction txn;
+	patch_transaction_begin(&txn);
+	scan_module(&txn, modid);
+	patch_transaction_commit(&txn);
+	scan_unlock();
+	int res = sceKernelStartModuleOrig(modid, argsize, argp, status, option);
 
 	pspSdkSetK1(k1);
 	return res;
 }
 
 static void log_modules(){
-	SceUID modules[10];
 	SceKernelModuleInfo info;
 	int i, count = 0;
 
-	if (sceKernelGetModuleIdList(modules, sizeof(modules), &count) >= 0) {
+	if (list_modules(&count) >= 0) {
 		for (i = 0; i < count; ++i) {
 			info.size = sizeof(SceKernelModuleInfo);
-			if (sceKernelQueryModuleInfo(modules[i], &info) < 0) {
+			if (sceKernelQueryModuleInfo(module_ids[i], &info) < 0) {
 				continue;
 			}
 			LOG("module #%d: %s\n", i+1, info.name);
@@ -428,134 +812,163 @@ static void log_modules(){
 	}
 }
 
-// up down left right
-enum axis_names{
-	AXIS_YN = 0,
-	AXIS_YP = 1,
-	AXIS_XN = 2,
-	AXIS_XP = 3,
-	AXIS_CNT = 4
-};
+// the whole config is loaded with a single read, a memory stick round trip per byte adds up at boot, the buffer
+// holds either a text config or a precompiled profile and is kept off the 4KB thread stack
+static union{
+	char text[PROFILE_DB_MAX_RECORD_SIZE];
+	struct profile profile;
+} config_buf;
+
+// returns -1 when the tables still have to be built from the defaults
+static int load_config(int len){
+	if(profile_is_binary(config_buf.text, len)){
+		if(len != sizeof(struct profile) || profile_check(&config_buf.profile) != 0){
+			LOG("bad binary profile, using the default config\n");
+			return -1;
+		}
+		LOG("using precompiled profile\n");
+		memcpy(&profile, &config_buf.profile, sizeof(profile));
+		return 0;
+	}
+	profile_parse_text(&profile, config_buf.text, len);
+	profile_build_tables(&profile);
+	return 0;
+}
 
-static void map_button(char *string, int axis){
-	char *axis_name;
-	switch(axis){
-		case AXIS_XP:
-			axis_name = "x positive";
-			break;
-		case AXIS_XN:
-			axis_name = "x negative";
-			break;
-		case AXIS_YP:
-			axis_name = "y positive";
-			break;
-		case AXIS_YN:
-			axis_name = "y negative";
+#define PROFILE_DB_PATH "ms0:/PSP/ra2d_conf/profiles.db"
+
+// one open and two reads however many titles the database carries, returns the record length in config_buf,
+// -1 when the title is not in it
+static int read_config_from_db(const char *name){
+	int fd = sceIoOpen(PROFILE_DB_PATH, PSP_O_RDONLY, 0777);
+	if(fd <= 0){
+		LOG_VERBOSE("no profile database at %s\n", PROFILE_DB_PATH);
+		return -1;
+	}
+
+	// the index is too big for the thread stack, borrow a kernel partition block for the lookup
+	u32 index_size = PROFILE_DB_INDEX_SIZE(PROFILE_DB_MAX_ENTRIES);
+	SceUID block_id = sceKernelAllocPartitionMemory(PSP_MEMORY_PARTITION_KERNEL, MODULE_NAME, PSP_SMEM_Low, index_size, NULL);
+	if(block_id < 0){
+		sceIoClose(fd);
+		LOG("failed allocating 0x%lx bytes for the profile database index, 0x%x\n", index_size, block_id);
+		return -1;
+	}
+	void *index_buf = sceKernelGetBlockHeadAddr(block_id);
+
+	int read_len = sceIoRead(fd, index_buf, index_size);
+	struct profile_db_header *header = index_buf;
+	struct profile_db_entry *entries = (struct profile_db_entry *)(header + 1);
+	if(read_len < (int)sizeof(struct profile_db_header) || memcmp(header->magic, PROFILE_DB_MAGIC, 4) != 0 || header->version != PROFILE_DB_VERSION || header->entry_cnt > PROFILE_DB_MAX_ENTRIES || read_len < PROFILE_DB_INDEX_SIZE(header->entry_cnt)){
+		sceKernelFreePartitionMemory(block_id);
+		sceIoClose(fd);
+		LOG("bad profile database %s\n", PROFILE_DB_PATH);
+		return -1;
+	}
+
+	u32 record_offset = 0;
+	u32 record_len = 0;
+	int found = 0;
+	int low = 0;
+	int high = header->entry_cnt - 1;
+	while(low <= high){
+		int mid = (low + high) / 2;
+		int cmp = strncmp(name, entries[mid].disc_id, PROFILE_DB_DISC_ID_SIZE);
+		if(cmp == 0){
+			record_offset = entries[mid].offset;
+			record_len = entries[mid].len;
+			found = 1;
 			break;
+		}
+		if(cmp < 0){
+			high = mid - 1;
+		}else{
+			low = mid + 1;
+		}
+	}
+	sceKernelFreePartitionMemory(block_id);
+
+	if(!found){
+		sceIoClose(fd);
+		LOG("%s is not in the profile database\n", name);
+		return -1;
+	}
+	if(record_len > sizeof(config_buf)){
+		sceIoClose(fd);
+		LOG("profile database record of %s is too long, %ld bytes\n", name, record_len);
+		return -1;
+	}
+
+	sceIoLseek(fd, record_offset, PSP_SEEK_SET);
+	int len = sceIoRead(fd, config_buf.text, record_len);
+	sceIoClose(fd);
+	if(len != record_len){
+		LOG("failed reading profile database record of %s, 0x%x\n", name, len);
+		return -1;
+	}
+
+	LOG("loading config of %s from %s\n", name, PROFILE_DB_PATH);
+	return len;
+}
+
+// returns -1 when no config was loaded
+static int read_config(char *disc_id, int disc_id_valid){
+	char *name = disc_id_valid ? disc_id : "homebrew";
+	int len = read_config_from_db(name);
+	if(len >= 0){
+		return load_config(len);
 	}
 
-	int button = -1;
-	#define STRING_BTN_PAIR(str, btn){ \
-		if(strcmp(string, str) == 0){ \
-			LOG("mapping %s to %s\n", axis_name, string); \
-			button = btn; \
-		} \
-	}
-	STRING_BTN_PAIR("up", PSP_CTRL_UP);
-	STRING_BTN_PAIR("right", PSP_CTRL_RIGHT);
-	STRING_BTN_PAIR("down", PSP_CTRL_DOWN);
-	STRING_BTN_PAIR("left", PSP_CTRL_LEFT);
-	STRING_BTN_PAIR("ltrigger", PSP_CTRL_LTRIGGER);
-	STRING_BTN_PAIR("rtrigger", PSP_CTRL_RTRIGGER);
-	STRING_BTN_PAIR("triangle", PSP_CTRL_TRIANGLE);
-	STRING_BTN_PAIR("circle", PSP_CTRL_CIRCLE);
-	STRING_BTN_PAIR("cross", PSP_CTRL_CROSS);
-	STRING_BTN_PAIR("square", PSP_CTRL_SQUARE);
-	STRING_BTN_PAIR("none", 0);
-
-	if(button != -1){
-		switch(axis){
-			case AXIS_XP:
-				xp_btn = button;
-				return;
-			case AXIS_XN:
-				xn_btn = button;
-				return;
-			case AXIS_YP:
-				yp_btn = button;
-				return;
-			case AXIS_YN:
-				yn_btn = button;
-				return;
-		}
-	}
-	LOG("unrecognized button %s while trying to map %s\n", string, axis_name);
-}
-
-static void read_config(char *disc_id, int disc_id_valid){
 	char path[100];
-	sprintf(path, "ms0:/PSP/ra2d_conf/%s", disc_id_valid ? disc_id: "homebrew");
+	sprintf(path, "ms0:/PSP/ra2d_conf/%s", name);
 	int fd = sceIoOpen(path, PSP_O_RDONLY, 0777);
 	if(fd <= 0){
 		LOG("cannot load config from %s\n", path);
-		return;
+		return -1;
+	}
+
+	len = sceIoRead(fd, config_buf.text, sizeof(config_buf));
+	sceIoClose(fd);
+	if(len < 0){
+		LOG("failed reading config from %s, 0x%x\n", path, len);
+		return -1;
 	}
 
+	return load_config(len);
+}
+
+static struct hook hooks[] = {
+	{"sceCtrlReadBufferPositive", sceCtrlReadBufferPositive, SCE_CTRL_READ_BUFFER_POSITIVE_NID, sceCtrlReadBufferPositivePatched, (void **)&sceCtrlReadBufferPositiveOrig, HOOK_REQUIRED},
+	{"sceCtrlReadBufferNegative", sceCtrlReadBufferNegative, SCE_CTRL_READ_BUFFER_NEGATIVE_NID, sceCtrlReadBufferNegativePatched, (void **)&sceCtrlReadBufferNegativeOrig, HOOK_REQUIRED},
+	{"sceCtrlPeekBufferPositive", sceCtrlPeekBufferPositive, SCE_CTRL_PEEK_BUFFER_POSITIVE_NID, sceCtrlPeekBufferPositivePatched, (void **)&sceCtrlPeekBufferPositiveOrig, HOOK_REQUIRED},
+	{"sceCtrlPeekBufferNegative", sceCtrlPeekBufferNegative, SCE_CTRL_PEEK_BUFFER_NEGATIVE_NID, sceCtrlPeekBufferNegativePatched, (void **)&sceCtrlPeekBufferNegativeOrig, HOOK_REQUIRED},
+	{"sceCtrlReadLatch", sceCtrlReadLatch, SCE_CTRL_READ_LATCH_NID, sceCtrlReadLatchPatched, (void **)&sceCtrlReadLatchOrig, 0},
+	{"sceCtrlPeekLatch", sceCtrlPeekLatch, SCE_CTRL_PEEK_LATCH_NID, sceCtrlPeekLatchPatched, (void **)&sceCtrlPeekLatchOrig, 0},
+	{"sceCtrlReadBufferPositive2", NULL, SCE_CTRL_READ_BUFFER_POSITIVE_2_NID, sceCtrlReadBufferPositive2Patched, (void **)&sceCtrlReadBufferPositive2Orig, 0},
+	{"sceCtrlReadBufferNegative2", NULL, SCE_CTRL_READ_BUFFER_NEGATIVE_2_NID, sceCtrlReadBufferNegative2Patched, (void **)&sceCtrlReadBufferNegative2Orig, 0},
+	{"sceCtrlPeekBufferPositive2", NULL, SCE_CTRL_PEEK_BUFFER_POSITIVE_2_NID, sceCtrlPeekBufferPositive2Patched, (void **)&sceCtrlPeekBufferPositive2Orig, 0},
+	{"sceCtrlPeekBufferNegative2", NULL, SCE_CTRL_PEEK_BUFFER_NEGATIVE_2_NID, sceCtrlPeekBufferNegative2Patched, (void **)&sceCtrlPeekBufferNegative2Orig, 0},
+	{"sceKernelStartModule", sceKernelStartModule, 0, sceKernelStartModulePatched, (void **)&sceKernelStartModuleOrig, HOOK_EMULATOR_ONLY}
+};
+#define HOOK_CNT (sizeof(hooks) / sizeof(hooks[0]))
+
+static void install_hooks(struct patch_transaction *txn){
 	int i;
-	for(i = 0;i < AXIS_CNT + 4; i++){
-		int j;
-		char readbuf[50];
-		for(j = 0;j < 50; j++){
-			if(sceIoRead(fd, &readbuf[j], 1) != 1){
-				LOG("bad config file\n");
-				sceIoClose(fd);
-				return;
-			}
-			if(readbuf[j] == ' ' || readbuf[j] == '\r' || readbuf[j] == '\n'){
-				readbuf[j] = '\0';
-				break;
-			}
-		}
-		if(readbuf[j] != '\0'){
-			LOG("bad config file with long button name\n");
-			sceIoClose(fd);
-			return;
+	for(i = 0;i < HOOK_CNT;i++){
+		struct hook *hook = &hooks[i];
+		if(*hook->orig != NULL){
+			continue;
 		}
-		if(i < AXIS_CNT){
-			map_button(readbuf, i);
-		}else if(i == AXIS_CNT){
-			int config_window = atoi(readbuf);
-			if(config_window > 0){
-				LOG("setting button inject window to %s samples\n", readbuf);
-				window = config_window;
-			}else{
-				LOG("bad button inject window input %s\n", readbuf);
-			}
-		}else if(i == AXIS_CNT + 1){
-			int controller_sampling_cycle = atoi(readbuf);
-			if(controller_sampling_cycle >= 5555 && controller_sampling_cycle <= 20000){
-				LOG("setting controller sampling cycle to %d\n", controller_sampling_cycle);
-				sceCtrlSetSamplingCycle(controller_sampling_cycle);
-			}else{
-				LOG("not setting controller sampling cycle to %s, invalid value\n", readbuf);
-			}
-		}else if(i == AXIS_CNT + 2){
-			if(strcmp(readbuf, "spread") == 0){
-				LOG("spreading out button injection in a window\n");
-				algo = 1;
-			}
-		}else{
-			int config_min_percent = atoi(readbuf);
-			if(config_min_percent < 0){
-				LOG("not setting minimal input to %s%%, invalid input\n", readbuf);
-			}else{
-				LOG("setting minimal input to %d%%\n", config_min_percent);
-				min_percent = config_min_percent;
+		if(!is_emulator){
+			if(!(hook->flags & HOOK_EMULATOR_ONLY)){
+				redirect_syscall(hook);
 			}
+			continue;
+		}
+		if(hook->stub != NULL){
+			hijack_syscall_stub(txn, hook);
 		}
 	}
-
-	sceIoClose(fd);
 }
 
 int main_thread(SceSize args, void *argp){
@@ -566,58 +979,96 @@ int main_thread(SceSize args, void *argp){
 	sceCtrlSetSamplingMode(PSP_CTRL_MODE_ANALOG);
 
 	char disc_id[50];
-	int disc_id_valid = get_disc_id(disc_id) == 0;
+	int disc_id_valid = get_disc_id(disc_id, sizeof(disc_id)) == 0;
 	if(disc_id_valid){
 		LOG("disc id is %s\n", disc_id);
 	}else{
 		LOG("cannot find disc id from sfo\n");
 	}
-	read_config(disc_id, disc_id_valid);
+	profile_set_defaults(&profile);
+	if(read_config(disc_id, disc_id_valid) != 0){
+		profile_build_tables(&profile);
+	}
+	if(profile.sampling_cycle != 0){
+		LOG("overriding controller sampling cycle with %ld\n", profile.sampling_cycle);
+		sceCtrlSetSamplingCycle(profile.sampling_cycle);
+	}
+	reset_mapping_state();
+	select_mapping_kernel();
+
+	if((profile.buttons[AXIS_XP] | profile.buttons[AXIS_XN] | profile.buttons[AXIS_YP] | profile.buttons[AXIS_YN]) == 0){
+		// leave the controller functions alone entirely, so disabled profiles add no input latency
+		LOG("no buttons mapped, not hooking\n");
+		return 0;
+	}
 
 	if(is_emulator){
 		log_modules();
 	}
 
 	// hooking this linked addr does not do anything on ppsspp, but joysens' implementation suggests that it works on real hw?
-	u32 sceCtrlReadBufferPositive_addr = (u32)sceCtrlReadBufferPositive;
-	u32 sceCtrlReadBufferNegative_addr = (u32)sceCtrlReadBufferNegative;
-	u32 sceCtrlPeekBufferPositive_addr = (u32)sceCtrlPeekBufferPositive;
-	u32 sceCtrlPeekBufferNegative_addr = (u32)sceCtrlPeekBufferNegative;
-
-	if(sceCtrlReadBufferPositive_addr == 0){
-		LOG("sceCtrlReadBufferPositive_addr is 0, bailing out\n");
-		return 1;
+	int i;
+	for(i = 0;i < HOOK_CNT;i++){
+		if((hooks[i].flags & HOOK_REQUIRED) && hooks[i].stub == NULL){
+			LOG("%s_addr is 0, bailing out\n", hooks[i].name);
+			return 1;
+		}
 	}
 
-	if(sceCtrlReadBufferNegative_addr == 0){
-		LOG("sceCtrlReadBufferNegative_addr is 0, bailing out\n");
-		return 1;
+	if(is_emulator){
+		LOG("now going into syscall stub hooking loop for ppsspp\n");
 	}
 
-	if(sceCtrlPeekBufferPositive_addr == 0){
-		LOG("sceCtrlPeekBufferPositive_addr is 0, bailing out\n");
+	scan_sema = sceKernelCreateSema("ra2d_scan", 0, 1, 1, NULL);
+	if(scan_sema < 0){
+		LOG("failed creating scan semaphore, 0x%x\n", scan_sema);
 		return 1;
 	}
 
-	if(sceCtrlPeekBufferNegative_addr == 0){
-		LOG("sceCtrlPeekBufferNegative_addr is 0, bailing out\n");
-		return 1;
-	}
+	int module_start_hooked = 0;
+	do{
+		scan_lock();
+		scan_pass++;
+		scan_words = 0;
 
-	if(is_emulator){
-		LOG("now going into syscall stub hooking loop for ppsspp\n");
-	}
+		struct patch_transaction txn;
+		patch_transaction_begin(&txn);
 
-	do{
-		HIJACK_SYSCALL_STUB(sceCtrlReadBufferPositive_addr, sceCtrlReadBufferPositivePatched, sceCtrlReadBufferPositiveOrig);
-		HIJACK_SYSCALL_STUB(sceCtrlReadBufferNegative_addr, sceCtrlReadBufferNegativePatched, sceCtrlReadBufferNegativeOrig);
-		HIJACK_SYSCALL_STUB(sceCtrlPeekBufferPositive_addr, sceCtrlPeekBufferPositivePatched, sceCtrlPeekBufferPositiveOrig);
-		HIJACK_SYSCALL_STUB(sceCtrlPeekBufferNegative_addr, sceCtrlPeekBufferNegativePatched, sceCtrlPeekBufferNegativeOrig);
+		install_hooks(&txn);
 
-		sceKernelDcacheWritebackAll();
-		sceKernelIcacheClearAll();
+		if(is_emulator){
+			// once module starts are hooked, new modules are patched by the hook as they start instead of by this poll
+			if(!module_start_hooked){
+				scan_modules(&txn);
+			}
+			patch_watchdog_tick(&txn);
+		}
+
+		patch_transaction_commit(&txn);
+
+		// the second word of the patch buffer is the saved syscall in ppsspp mode
+		if(is_emulator && !module_start_hooked && sceKernelStartModuleOrig != NULL && scan_target_hits(_lw((u32)sceKernelStartModuleOrig + 4)) > 0){
+			// a module started between the listing and the commit above went through a stub that was not patched
+			// yet, so list once more now that every later start goes through the hook, which waits for this pass
+			patch_transaction_begin(&txn);
+			scan_modules(&txn);
+			patch_transaction_commit(&txn);
+			LOG("module start stubs hooked, no longer polling for new modules, only watching patch sites\n");
+			module_start_hooked = 1;
+		}
+		scan_unlock();
+
+		if(is_emulator){
+			// only passes that found new modules are worth a line in the log
+			if(scan_words != 0){
+				LOG("hooking pass %ld scanned %ld words\n", scan_pass, scan_words);
+			}else{
+				LOG_VERBOSE("hooking pass %ld scanned %ld words\n", scan_pass, scan_words);
+			}
+		}
 
 		if(is_emulator){
+			// after the module start hook is in, this only paces the patch site watchdog
 			sceKernelDelayThread(1000 * 1000 * 5);
 		}
 	}while(is_emulator);
@@ -626,9 +1077,19 @@ int main_thread(SceSize args, void *argp){
 	return 0;
 }
 
+// real hw calls init on every module start, but the config is only loaded once, a second main thread would reload
+// the live profile while the installed hooks read it
+static int main_thread_started = 0;
+
 void init(){
+	if(main_thread_started){
+		return;
+	}
+
 	#if DEBUG
-	logfd = sceIoOpen("ms0:/PSP/ra2d.log", PSP_O_WRONLY|PSP_O_CREAT|PSP_O_TRUNC, 0777);
+	if(logfd <= 0){
+		logfd = sceIoOpen("ms0:/PSP/ra2d.log", PSP_O_WRONLY|PSP_O_CREAT|PSP_O_TRUNC, 0777);
+	}
 	#endif
 
 	LOG("module started\n");
@@ -639,6 +1100,7 @@ void init(){
 	}
 	LOG("created thread with thid 0x%x\n", thid);
 	sceKernelStartThread(thid, 0, NULL);
+	main_thread_started = 1;
 	LOG("main thread started\n");
 }
 
@@ -0,0 +1,216 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2018, TheFloW
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// the per sample button injection, shared by the hooks and the host tools
+
+#include <stdint.h>
+
+#include "log.h"
+#include "mapping.h"
+#include "profile.h"
+
+struct profile profile;
+
+// counts samples handed to the game across all hooks, TimeStamp is in microseconds so it drifts with the sampling cycle
+static uint32_t sample_phase;
+
+uint32_t last_injected;
+uint32_t last_mapped_timestamp;
+
+// sigma delta carries the unspent part of each axis' duty cycle over to the next sample
+static uint32_t sigma_delta_acc[AXIS_CNT];
+
+// the mapping state starts over whenever a config is loaded
+void reset_mapping_state(){
+	int axis;
+	for(axis = 0;axis < AXIS_CNT;axis++){
+		sigma_delta_acc[axis] = profile.window - 1;
+	}
+	sample_phase = 0;
+}
+
+static int sigma_delta_on(int axis, uint32_t slice){
+	if(slice == 0){
+		// primed so that the next deflection presses on its very first sample
+		sigma_delta_acc[axis] = profile.window - 1;
+		return 0;
+	}
+	uint32_t acc = sigma_delta_acc[axis] + slice;
+	if(acc >= profile.window){
+		sigma_delta_acc[axis] = acc - profile.window;
+		return 1;
+	}
+	sigma_delta_acc[axis] = acc;
+	return 0;
+}
+
+static inline __attribute__((always_inline)) int axis_on(int axis, int val, uint32_t phase_bit, int sigma_delta){
+	if(sigma_delta){
+		return sigma_delta_on(axis, profile.level_slices[val]);
+	}
+	return profile.level_patterns[val] & phase_bit;
+}
+
+static inline __attribute__((always_inline)) int radial_scale(int val, uint32_t gain){
+	int mag = val < 0 ? -val : val;
+	// rounded to the nearest unit rather than down, the gains are sampled at the middle of each step
+	mag = (mag * gain + (1 << 7)) >> 8;
+	if(mag > 127){
+		mag = 127;
+	}
+	return val < 0 ? -mag : mag;
+}
+
+// the mapping loop is instantiated once per combination of mapped stick axes, axial vs radial deadzone and pattern
+// vs sigma delta modulation, so the hooks only carry the work the loaded config needs, polarity is applied as a xor mask,
+// samples are stride bytes apart so the extended reads' bigger records go through the same kernels
+typedef void (*mapping_kernel)(SceCtrlData *pad_data, int count, uint32_t stride, uint32_t flip);
+
+static inline __attribute__((always_inline)) void mapping_kernel_body(SceCtrlData *pad_data, int count, uint32_t stride, uint32_t flip, int x_active, int y_active, int radial, int sigma_delta){
+	// buffered samples are consecutive input frames, oldest first, so the phase just steps per sample handed to the game
+	uint32_t phase = sample_phase;
+	int inner_deadzone_sq = profile.inner_deadzone * profile.inner_deadzone;
+	SceCtrlData *sample = pad_data;
+
+	int i;
+	for(i = 0;i < count; i++){
+		sample = (SceCtrlData *)((char *)pad_data + i * stride);
+		uint32_t injected = 0;
+		uint32_t phase_bit = 1u << phase;
+		phase++;
+		if(phase >= profile.window){
+			phase = 0;
+		}
+
+		int x_val = sample->Rsrv[0] - 128;
+		int y_val = sample->Rsrv[1] - 128;
+		if(radial){
+			int x_mag = x_val < 0 ? -x_val : x_val;
+			int y_mag = y_val < 0 ? -y_val : y_val;
+			int major = (x_mag > y_mag ? x_mag : y_mag) >> RADIAL_SHIFT;
+			int minor = (x_mag > y_mag ? y_mag : x_mag) >> RADIAL_SHIFT;
+			uint32_t gain = profile.radial_gains[major * (major + 1) / 2 + minor];
+			if(x_val * x_val + y_val * y_val < inner_deadzone_sq){
+				gain = 0;
+			}
+			// judged on the stick's own units, scaling would push the threshold out past the inner deadzone
+			if(x_mag < RADIAL_AXIS_FLOOR){
+				x_val = 0;
+			}
+			if(y_mag < RADIAL_AXIS_FLOOR){
+				y_val = 0;
+			}
+			x_val = radial_scale(x_val, gain);
+			y_val = radial_scale(y_val, gain);
+		}
+
+		// level 0 never presses, so the direction the stick is not pushed towards can go through the same path
+		if(x_active){
+			int xp_val = x_val > 0 ? x_val : 0;
+			int xn_val = x_val < 0 ? -x_val : 0;
+			if(xn_val == 128){
+				xn_val = 127;
+			}
+			if(axis_on(AXIS_XP, xp_val, phase_bit, sigma_delta))
+				injected |= profile.buttons[AXIS_XP];
+			if(axis_on(AXIS_XN, xn_val, phase_bit, sigma_delta))
+				injected |= profile.buttons[AXIS_XN];
+		}
+		if(y_active){
+			int yp_val = y_val > 0 ? y_val : 0;
+			int yn_val = y_val < 0 ? -y_val : 0;
+			if(yn_val == 128){
+				yn_val = 127;
+			}
+			if(axis_on(AXIS_YP, yp_val, phase_bit, sigma_delta))
+				injected |= profile.buttons[AXIS_YP];
+			if(axis_on(AXIS_YN, yn_val, phase_bit, sigma_delta))
+				injected |= profile.buttons[AXIS_YN];
+		}
+
+		LOG_VERBOSE("timestamp: %d rx: %d ry: %d\n", sample->TimeStamp, sample->Rsrv[0], sample->Rsrv[1]);
+		sample->Buttons = ((sample->Buttons ^ flip) | injected) ^ flip;
+		last_injected = injected;
+	}
+	sample_phase = phase;
+	last_mapped_timestamp = sample->TimeStamp;
+}
+
+#define MAPPING_KERNEL(name, x_active, y_active, radial, sigma_delta) \
+static void name(SceCtrlData *pad_data, int count, uint32_t stride, uint32_t flip){ \
+	mapping_kernel_body(pad_data, count, stride, flip, x_active, y_active, radial, sigma_delta); \
+}
+
+MAPPING_KERNEL(map_none, 0, 0, 0, 0)
+MAPPING_KERNEL(map_x_pattern, 1, 0, 0, 0)
+MAPPING_KERNEL(map_y_pattern, 0, 1, 0, 0)
+MAPPING_KERNEL(map_xy_pattern, 1, 1, 0, 0)
+MAPPING_KERNEL(map_x_sigma_delta, 1, 0, 0, 1)
+MAPPING_KERNEL(map_y_sigma_delta, 0, 1, 0, 1)
+MAPPING_KERNEL(map_xy_sigma_delta, 1, 1, 0, 1)
+MAPPING_KERNEL(map_x_radial_pattern, 1, 0, 1, 0)
+MAPPING_KERNEL(map_y_radial_pattern, 0, 1, 1, 0)
+MAPPING_KERNEL(map_xy_radial_pattern, 1, 1, 1, 0)
+MAPPING_KERNEL(map_x_radial_sigma_delta, 1, 0, 1, 1)
+MAPPING_KERNEL(map_y_radial_sigma_delta, 0, 1, 1, 1)
+MAPPING_KERNEL(map_xy_radial_sigma_delta, 1, 1, 1, 1)
+
+// [radial][sigma delta][x active][y active]
+static const mapping_kernel mapping_kernels[2][2][2][2] = {
+	{
+		{{map_none, map_y_pattern}, {map_x_pattern, map_xy_pattern}},
+		{{map_none, map_y_sigma_delta}, {map_x_sigma_delta, map_xy_sigma_delta}}
+	},
+	{
+		{{map_none, map_y_radial_pattern}, {map_x_radial_pattern, map_xy_radial_pattern}},
+		{{map_none, map_y_radial_sigma_delta}, {map_x_radial_sigma_delta, map_xy_radial_sigma_delta}}
+	}
+};
+
+static mapping_kernel active_mapping_kernel = map_xy_pattern;
+
+void select_mapping_kernel(){
+	int radial = profile.deadzone_mode != DEADZONE_AXIAL;
+	int sigma_delta = profile.algo == ALGO_SIGMA_DELTA;
+	int x_active = (profile.buttons[AXIS_XP] | profile.buttons[AXIS_XN]) != 0;
+	int y_active = (profile.buttons[AXIS_YP] | profile.buttons[AXIS_YN]) != 0;
+	LOG("selecting mapping kernel, x axis %s, y axis %s, %s deadzone, %s modulation\n", x_active ? "mapped" : "unmapped", y_active ? "mapped" : "unmapped", radial ? "radial" : "axial", sigma_delta ? "sigma delta" : "pattern");
+	active_mapping_kernel = mapping_kernels[radial][sigma_delta][x_active][y_active];
+}
+
+void apply_analog_to_digital(SceCtrlData *pad_data, int count, int negative){
+	if(count < 1){
+		LOG("count is %d, processing skipped\n", count);
+		return;
+	}
+
+	LOG_VERBOSE("processing %d buffers in %s mode\n", count, negative? "negative" : "positive");
+
+	active_mapping_kernel(pad_data, count, sizeof(SceCtrlData), negative ? 0xFFFFFFFF : 0);
+}
+
+void apply_analog_to_digital_ext(struct ctrl_data_ext *pad_data, int count, int negative){
+	if(count < 1){
+		LOG("count is %d, processing skipped\n", count);
+		return;
+	}
+
+	LOG_VERBOSE("processing %d extended buffers in %s mode\n", count, negative? "negative" : "positive");
+
+	active_mapping_kernel(&pad_data->data, count, sizeof(struct ctrl_data_ext), negative ? 0xFFFFFFFF : 0);
+}
@@ -0,0 +1,57 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2018, TheFloW
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __MAPPING_H__
+#define __MAPPING_H__
+
+#include <stdint.h>
+
+#include "profile.h"
+
+#ifdef RA2D_HOST
+// layout from pspctrl.h, for the host tools
+typedef struct SceCtrlData{
+	unsigned int TimeStamp;
+	unsigned int Buttons;
+	unsigned char Lx;
+	unsigned char Ly;
+	unsigned char Rsrv[6];
+} SceCtrlData;
+#endif // RA2D_HOST
+
+// the extended sceCtrl{Read,Peek}Buffer{Positive,Negative}2 reads fill these, a plain sample followed by the pressure
+// and tilt fields the sdk does not declare, 48 bytes per record
+struct ctrl_data_ext{
+	SceCtrlData data;
+	int32_t extra[8];
+};
+
+// to be set by config, the lookup tables are built along with it
+extern struct profile profile;
+
+// the latch hooks reuse the buttons injected into the newest mapped sample
+extern uint32_t last_injected;
+extern uint32_t last_mapped_timestamp;
+
+void reset_mapping_state();
+void select_mapping_kernel();
+void apply_analog_to_digital(SceCtrlData *pad_data, int count, int negative);
+void apply_analog_to_digital_ext(struct ctrl_data_ext *pad_data, int count, int negative);
+
+#endif
@@ -0,0 +1,468 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// config parsing and table building, shared by the plugin and the host tools so both produce the same tables
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "profile.h"
+
+static unsigned char response_curve[128];
+
+void profile_set_defaults(struct profile *profile){
+	memset(profile, 0, sizeof(*profile));
+	profile->buttons[AXIS_YP] = PSP_CTRL_SQUARE;
+	profile->buttons[AXIS_YN] = PSP_CTRL_CROSS;
+	profile->window = 8; // frame
+	profile->algo = ALGO_GROUP;
+	profile->curve = CURVE_LINEAR;
+	profile->deadzone_mode = DEADZONE_AXIAL;
+	profile->inner_deadzone = 10;
+	profile->outer_deadzone = 20;
+}
+
+static void map_button(struct profile *profile, char *string, int axis){
+	char *axis_name;
+	switch(axis){
+		case AXIS_XP:
+			axis_name = "x positive";
+			break;
+		case AXIS_XN:
+			axis_name = "x negative";
+			break;
+		case AXIS_YP:
+			axis_name = "y positive";
+			break;
+		default:
+			axis_name = "y negative";
+			break;
+	}
+
+	int button = -1;
+	#define STRING_BTN_PAIR(str, btn){ \
+		if(strcmp(string, str) == 0){ \
+			LOG("mapping %s to %s\n", axis_name, string); \
+			button = btn; \
+		} \
+	}
+	STRING_BTN_PAIR("up", PSP_CTRL_UP);
+	STRING_BTN_PAIR("right", PSP_CTRL_RIGHT);
+	STRING_BTN_PAIR("down", PSP_CTRL_DOWN);
+	STRING_BTN_PAIR("left", PSP_CTRL_LEFT);
+	STRING_BTN_PAIR("ltrigger", PSP_CTRL_LTRIGGER);
+	STRING_BTN_PAIR("rtrigger", PSP_CTRL_RTRIGGER);
+	STRING_BTN_PAIR("triangle", PSP_CTRL_TRIANGLE);
+	STRING_BTN_PAIR("circle", PSP_CTRL_CIRCLE);
+	STRING_BTN_PAIR("cross", PSP_CTRL_CROSS);
+	STRING_BTN_PAIR("square", PSP_CTRL_SQUARE);
+	STRING_BTN_PAIR("none", 0);
+
+	if(button != -1){
+		profile->buttons[axis] = button;
+		return;
+	}
+	LOG("unrecognized button %s while trying to map %s\n", string, axis_name);
+}
+
+static void parse_curve(struct profile *profile, char *string){
+	if(strcmp(string, "linear") == 0){
+		LOG("using linear response curve\n");
+		profile->curve = CURVE_LINEAR;
+		return;
+	}
+	if(strcmp(string, "expo") == 0){
+		LOG("using exponential response curve\n");
+		profile->curve = CURVE_EXPO;
+		return;
+	}
+	if(strcmp(string, "scurve") == 0){
+		LOG("using s response curve\n");
+		profile->curve = CURVE_SCURVE;
+		return;
+	}
+
+	// custom curves are a comma separated list of output percentages, evenly spaced across the stick range
+	unsigned char points[MAX_CURVE_POINTS];
+	int cnt = 0;
+	char *cur = string;
+	while(1){
+		if(*cur < '0' || *cur > '9' || cnt == MAX_CURVE_POINTS){
+			LOG("bad response curve %s\n", string);
+			return;
+		}
+		int point = atoi(cur);
+		if(point > 100){
+			LOG("bad response curve %s\n", string);
+			return;
+		}
+		points[cnt] = point;
+		cnt++;
+		while(*cur >= '0' && *cur <= '9'){
+			cur++;
+		}
+		if(*cur == '\0'){
+			break;
+		}
+		if(*cur != ','){
+			LOG("bad response curve %s\n", string);
+			return;
+		}
+		cur++;
+	}
+	if(cnt < 2){
+		LOG("bad response curve %s, needs at least 2 points\n", string);
+		return;
+	}
+	LOG("using custom response curve with %d points\n", cnt);
+	memcpy(profile->curve_points, points, cnt);
+	profile->curve_point_cnt = cnt;
+	profile->curve = CURVE_CUSTOM;
+}
+
+static int is_config_separator(char c){
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// copies the next whitespace separated field of buf into token, returns the field length, 0 once the config ends,
+// either at the end of buf or at a blank line since anything after it is free form notes, -1 if the field does not
+// fit into token
+static int next_config_token(const char *buf, int len, int *pos, char *token, int token_size){
+	int newlines = 0;
+	while(*pos < len && is_config_separator(buf[*pos])){
+		if(buf[*pos] == '\n'){
+			newlines++;
+		}
+		(*pos)++;
+	}
+	if(*pos == len || buf[*pos] == '\0' || newlines >= 2){
+		return 0;
+	}
+
+	int j = 0;
+	while(*pos < len && buf[*pos] != '\0' && !is_config_separator(buf[*pos])){
+		if(j == token_size - 1){
+			return -1;
+		}
+		token[j] = buf[*pos];
+		j++;
+		(*pos)++;
+	}
+	token[j] = '\0';
+	return j;
+}
+
+static void apply_config_field(struct profile *profile, int field, char *value){
+	if(field < AXIS_CNT){
+		map_button(profile, value, field);
+	}else if(field == AXIS_CNT){
+		int config_window = atoi(value);
+		if(config_window > MAX_WINDOW){
+			// older versions took any window, keep such configs as close to what they were as the pattern words allow
+			LOG("button inject window %s is over %d samples, clamping it to %d\n", value, MAX_WINDOW, MAX_WINDOW);
+			profile->window = MAX_WINDOW;
+		}else if(config_window > 0){
+			LOG("setting button inject window to %s samples\n", value);
+			profile->window = config_window;
+		}else{
+			LOG("bad button inject window input %s\n", value);
+		}
+	}else if(field == AXIS_CNT + 1){
+		int controller_sampling_cycle = atoi(value);
+		if(controller_sampling_cycle >= 5555 && controller_sampling_cycle <= 20000){
+			LOG("setting controller sampling cycle to %d\n", controller_sampling_cycle);
+			profile->sampling_cycle = controller_sampling_cycle;
+		}else{
+			LOG("not setting controller sampling cycle to %s, invalid value\n", value);
+		}
+	}else if(field == AXIS_CNT + 2){
+		if(strcmp(value, "spread") == 0){
+			LOG("spreading out button injection in a window\n");
+			profile->algo = ALGO_SPREAD;
+		}else if(strcmp(value, "sigmadelta") == 0){
+			LOG("carrying button injection over between samples\n");
+			profile->algo = ALGO_SIGMA_DELTA;
+		}else if(strcmp(value, "even") == 0){
+			LOG("spacing out button injection evenly in a window\n");
+			profile->algo = ALGO_EVEN;
+		}
+	}else if(field == AXIS_CNT + 3){
+		int config_min_percent = atoi(value);
+		if(config_min_percent < 0 || config_min_percent > 100){
+			LOG("not setting minimal input to %s%%, invalid input\n", value);
+		}else{
+			LOG("setting minimal input to %d%%\n", config_min_percent);
+			profile->min_percent = config_min_percent;
+		}
+	}else if(field == AXIS_CNT + 4){
+		parse_curve(profile, value);
+	}else if(field == AXIS_CNT + 5){
+		if(strcmp(value, "axial") == 0){
+			LOG("using axial deadzone\n");
+			profile->deadzone_mode = DEADZONE_AXIAL;
+		}else if(strcmp(value, "radial") == 0){
+			LOG("using radial deadzone\n");
+			profile->deadzone_mode = DEADZONE_RADIAL;
+		}else if(strcmp(value, "scaledradial") == 0){
+			LOG("using scaled radial deadzone\n");
+			profile->deadzone_mode = DEADZONE_SCALED_RADIAL;
+		}else{
+			LOG("unrecognized deadzone mode %s\n", value);
+		}
+	}else{
+		int config_deadzone = atoi(value);
+		int is_inner = field == AXIS_CNT + 6;
+		if(config_deadzone < 0 || config_deadzone > 126){
+			LOG("not setting %s deadzone to %s, invalid input\n", is_inner ? "inner" : "outer", value);
+		}else if(is_inner){
+			LOG("setting inner deadzone to %d\n", config_deadzone);
+			profile->inner_deadzone = config_deadzone;
+		}else{
+			LOG("setting outer deadzone to %d\n", config_deadzone);
+			profile->outer_deadzone = config_deadzone;
+		}
+	}
+}
+
+void profile_parse_text(struct profile *profile, const char *buf, int len){
+	int pos = 0;
+	int field;
+	for(field = 0;field < AXIS_CNT + 8;field++){
+		char token[50];
+		int token_len = next_config_token(buf, len, &pos, token, sizeof(token));
+		if(token_len < 0){
+			LOG("bad config file with long field\n");
+			return;
+		}
+		if(token_len == 0){
+			return;
+		}
+		apply_config_field(profile, field, token);
+	}
+}
+
+// in radial modes the vector magnitude is already deadzoned before the per axis levels
+static int axis_inner_deadzone(const struct profile *profile){
+	return profile->deadzone_mode == DEADZONE_AXIAL ? profile->inner_deadzone : 0;
+}
+
+static int axis_outer_deadzone(const struct profile *profile){
+	return profile->deadzone_mode == DEADZONE_SCALED_RADIAL ? 0 : profile->outer_deadzone;
+}
+
+static int level_range(const struct profile *profile){
+	return (127 - axis_outer_deadzone(profile)) - (axis_inner_deadzone(profile));
+}
+
+// maps 0 - max_val onto itself, 0 is the edge of the inner deadzone and max_val the edge of the outer deadzone
+static void build_response_curve(const struct profile *profile, int max_val){
+	int curve_point_cnt = profile->curve_point_cnt;
+	const unsigned char *curve_points = profile->curve_points;
+	int val;
+	for(val = 0;val <= max_val;val++){
+		int out = val;
+		switch(profile->curve){
+			case CURVE_EXPO:
+				out = val * val / max_val;
+				break;
+			case CURVE_SCURVE:
+				out = val * val * (3 * max_val - 2 * val) / (max_val * max_val);
+				break;
+			case CURVE_CUSTOM:{
+				int pos = val * (curve_point_cnt - 1);
+				int seg = pos / max_val;
+				int percent = curve_points[seg];
+				if(seg < curve_point_cnt - 1){
+					percent += (curve_points[seg + 1] - curve_points[seg]) * (pos % max_val) / max_val;
+				}
+				out = percent * max_val / 100;
+				break;
+			}
+		}
+		response_curve[val] = out;
+	}
+}
+
+static uint32_t level_slice(const struct profile *profile, int val){
+	uint32_t window = profile->window;
+	int max_val = level_range(profile);
+	if(max_val <= 0){
+		return 0;
+	}
+	if(val < axis_inner_deadzone(profile)){
+		return 0;
+	}else{
+		val = val - axis_inner_deadzone(profile);
+	}
+	if(val > max_val){
+		val = max_val;
+	}
+
+	uint32_t min_slice = window * profile->min_percent / 100;
+	if(min_slice == 0){
+		min_slice = 1;
+	}
+	return min_slice + (response_curve[val] * (window - min_slice)) / max_val;
+}
+
+static int button_on(const struct profile *profile, uint32_t slice, uint32_t n){
+	uint32_t window = profile->window;
+	switch(profile->algo){
+		case ALGO_GROUP:
+			return slice >= n;
+		case ALGO_SPREAD:{
+			int odd_frames = window / 2 + window % 2;
+			int slice_odd = slice > odd_frames ? odd_frames : slice;
+			int slice_even = slice > slice_odd ? slice - slice_odd : 0;
+			if(n % 2 == 0){
+				return slice_even >= n / 2;
+			}else{
+				return slice_odd >= 1 + n / 2;
+			}
+		}
+		case ALGO_EVEN:
+			// bresenham, press whenever the running slice / window ratio crosses a whole frame
+			return (n * slice) / window != ((n - 1) * slice) / window;
+		default:
+			return 0;
+	}
+}
+
+static uint32_t isqrt(uint32_t val){
+	uint32_t res = 0;
+	uint32_t bit = 1 << 30;
+	while(bit > val){
+		bit >>= 2;
+	}
+	while(bit != 0){
+		if(val >= res + bit){
+			val -= res + bit;
+			res = (res >> 1) + bit;
+		}else{
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+	return res;
+}
+
+// gains are 8 bit fixed point, the kernel applies the inner deadzone itself on the exact magnitude, so plain radial
+// gains are all 1, while scaled radial gains are sampled at the middle of each quantization step, in 1/8 units, and
+// always leave at least a unit of push in a step that reaches past the inner deadzone, so pressing starts right at
+// its edge just like it does with the axial deadzone
+static void build_radial_gains(struct profile *profile){
+	int inner_deadzone = profile->inner_deadzone;
+	int max_val = (127 - (int)profile->outer_deadzone) - inner_deadzone;
+	int major;
+	for(major = 0;major < RADIAL_STEPS;major++){
+		int minor;
+		for(minor = 0;minor <= major;minor++){
+			// twice the step's middle, so the half unit stays whole
+			int major_mid = (major << (RADIAL_SHIFT + 1)) + (1 << RADIAL_SHIFT) - 1;
+			int minor_mid = (minor << (RADIAL_SHIFT + 1)) + (1 << RADIAL_SHIFT) - 1;
+			int mag = isqrt(16 * (major_mid * major_mid + minor_mid * minor_mid));
+			uint32_t gain = 0;
+			if(max_val > 0){
+				if(profile->deadzone_mode != DEADZONE_SCALED_RADIAL){
+					gain = 1 << 8;
+				}else{
+					int scaled = (mag - inner_deadzone * 8) * 127 / max_val;
+					if(inner_deadzone > 0 && scaled * inner_deadzone < mag){
+						// a push right at the deadzone's edge still scales to a whole unit
+						scaled = (mag + inner_deadzone - 1) / inner_deadzone;
+					}
+					if(scaled < 8){
+						scaled = 8;
+					}else if(scaled > 127 * 8){
+						scaled = 127 * 8;
+					}
+					gain = ((scaled << 8) + mag / 2) / mag;
+				}
+			}
+			profile->radial_gains[major * (major + 1) / 2 + minor] = gain;
+		}
+	}
+}
+
+void profile_build_tables(struct profile *profile){
+	int val;
+	if(level_range(profile) > 0){
+		build_response_curve(profile, level_range(profile));
+	}
+	if(profile->deadzone_mode != DEADZONE_AXIAL){
+		build_radial_gains(profile);
+	}
+	for(val = 0;val < 128;val++){
+		// level 0 is a centered stick, which never presses
+		uint32_t slice = val == 0 ? 0 : level_slice(profile, val);
+		profile->level_slices[val] = slice;
+		uint32_t pattern = 0;
+		uint32_t n;
+		for(n = 1;n <= profile->window;n++){
+			if(button_on(profile, slice, n)){
+				pattern |= 1u << (n - 1);
+			}
+		}
+		profile->level_patterns[val] = pattern;
+		LOG_VERBOSE("val is %d, slice is %d, pattern is 0x%x\n", val, (int)slice, (unsigned int)pattern);
+	}
+}
+
+uint32_t profile_checksum(const struct profile *profile){
+	const unsigned char *cur = (const unsigned char *)&profile->checksum + sizeof(profile->checksum);
+	const unsigned char *end = (const unsigned char *)profile + sizeof(*profile);
+	uint32_t hash = 2166136261u;
+	while(cur < end){
+		hash = (hash ^ *cur) * 16777619u;
+		cur++;
+	}
+	return hash;
+}
+
+void profile_seal(struct profile *profile){
+	memcpy(profile->magic, PROFILE_MAGIC, 4);
+	profile->version = PROFILE_VERSION;
+	profile->size = sizeof(*profile);
+	profile->checksum = profile_checksum(profile);
+}
+
+int profile_is_binary(const void *buf, int len){
+	return len >= 4 && memcmp(buf, PROFILE_MAGIC, 4) == 0;
+}
+
+// the tables are trusted once the checksum matches, the fields the mapping loop indexes or divides by are still range checked
+int profile_check(const struct profile *profile){
+	if(memcmp(profile->magic, PROFILE_MAGIC, 4) != 0){
+		LOG("bad profile magic\n");
+		return -1;
+	}
+	if(profile->version != PROFILE_VERSION || profile->size != sizeof(*profile)){
+		LOG("unsupported profile version %d, size %d\n", (int)profile->version, (int)profile->size);
+		return -1;
+	}
+	if(profile->checksum != profile_checksum(profile)){
+		LOG("bad profile checksum\n");
+		return -1;
+	}
+	if(profile->window == 0 || profile->window > MAX_WINDOW || profile->algo > ALGO_EVEN || profile->min_percent > 100 || profile->deadzone_mode > DEADZONE_SCALED_RADIAL || profile->inner_deadzone > 126 || profile->outer_deadzone > 126){
+		LOG("bad profile settings\n");
+		return -1;
+	}
+	return 0;
+}
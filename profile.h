@@ -0,0 +1,128 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdint.h>
+
+#ifndef RA2D_HOST
+#include <pspctrl.h>
+#else // RA2D_HOST
+// values from pspctrl.h, for the host tools
+#define PSP_CTRL_UP 0x000010
+#define PSP_CTRL_RIGHT 0x000020
+#define PSP_CTRL_DOWN 0x000040
+#define PSP_CTRL_LEFT 0x000080
+#define PSP_CTRL_LTRIGGER 0x000100
+#define PSP_CTRL_RTRIGGER 0x000200
+#define PSP_CTRL_TRIANGLE 0x001000
+#define PSP_CTRL_CIRCLE 0x002000
+#define PSP_CTRL_CROSS 0x004000
+#define PSP_CTRL_SQUARE 0x008000
+#endif // RA2D_HOST
+
+// up down left right
+enum axis_names{
+	AXIS_YN = 0,
+	AXIS_YP = 1,
+	AXIS_XN = 2,
+	AXIS_XP = 3,
+	AXIS_CNT = 4
+};
+
+enum algo_names{
+	ALGO_GROUP = 0,
+	ALGO_SPREAD = 1,
+	ALGO_SIGMA_DELTA = 2,
+	ALGO_EVEN = 3
+};
+
+enum deadzone_names{
+	DEADZONE_AXIAL = 0,
+	DEADZONE_RADIAL = 1,
+	DEADZONE_SCALED_RADIAL = 2
+};
+
+enum curve_names{
+	CURVE_LINEAR = 0,
+	CURVE_EXPO = 1,
+	CURVE_SCURVE = 2,
+	CURVE_CUSTOM = 3
+};
+
+#define MAX_CURVE_POINTS 16
+
+// the press pattern of a window is kept as a bitmask, one bit per frame
+#define MAX_WINDOW 32
+
+// radial deadzones scale both axes by a gain looked up from the stick's octant folded vector,
+// quantized to 1 << RADIAL_SHIFT units, stored as a triangle since the minor axis never exceeds the major axis
+#define RADIAL_SHIFT 2
+#define RADIAL_STEPS ((128 >> RADIAL_SHIFT) + 1)
+#define RADIAL_GAIN_CNT (RADIAL_STEPS * (RADIAL_STEPS + 1) / 2)
+
+// in radial modes an axis component below this does not press, judged before scaling, it is under the gain table's
+// resolution and would otherwise press the orthogonal button 1/window of the time while pushing along the other axis
+#define RADIAL_AXIS_FLOOR (1 << RADIAL_SHIFT)
+
+// a config with its lookup tables already built, either from the text syntax at boot or ahead of time by
+// tools/ra2d_profile, in which case the plugin only reads and checksums it
+//
+// the binary form is this struct as is, little endian, and is told apart from text configs by its magic
+#define PROFILE_MAGIC "RA2P"
+#define PROFILE_VERSION 3
+
+struct profile{
+	char magic[4];
+	uint32_t version;
+	// sizeof(struct profile), a cheap guard against layout changes that forgot the version bump
+	uint32_t size;
+	// fnv-1a over everything after this field
+	uint32_t checksum;
+
+	// PSP_CTRL_* masks, 0 for none
+	uint32_t buttons[AXIS_CNT];
+	uint32_t window;
+	// sceCtrlSetSamplingCycle override in microseconds, 0 keeps the game's own
+	uint32_t sampling_cycle;
+	uint32_t algo;
+	uint32_t min_percent;
+	uint32_t curve;
+	uint32_t curve_point_cnt;
+	uint8_t curve_points[MAX_CURVE_POINTS];
+	uint32_t deadzone_mode;
+	uint32_t inner_deadzone;
+	uint32_t outer_deadzone;
+
+	// bit n of level_patterns[val] tells whether the button is held on frame n of the window
+	uint32_t level_patterns[128];
+	uint8_t level_slices[128];
+	// 8 bit fixed point, only built for the radial deadzone modes
+	uint16_t radial_gains[RADIAL_GAIN_CNT];
+};
+
+void profile_set_defaults(struct profile *profile);
+void profile_parse_text(struct profile *profile, const char *buf, int len);
+void profile_build_tables(struct profile *profile);
+uint32_t profile_checksum(const struct profile *profile);
+void profile_seal(struct profile *profile);
+int profile_is_binary(const void *buf, int len);
+int profile_check(const struct profile *profile);
+
+#endif
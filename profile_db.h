@@ -0,0 +1,52 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PROFILE_DB_H__
+#define __PROFILE_DB_H__
+
+#include <stdint.h>
+
+// shared between the plugin and tools/ra2d_db, all fields are little endian
+//
+// layout: header, index sorted by disc id with strcmp, then the config records
+// the plugin reads the header and index with one fixed size read, then the matching record with another
+
+#define PROFILE_DB_MAGIC "RADB"
+#define PROFILE_DB_VERSION 1
+#define PROFILE_DB_MAX_ENTRIES 1024
+#define PROFILE_DB_DISC_ID_SIZE 16
+// a text config or a precompiled profile, the plugin reads either into the same buffer
+#define PROFILE_DB_MAX_RECORD_SIZE 2048
+
+struct profile_db_header{
+	char magic[4];
+	uint32_t version;
+	uint32_t entry_cnt;
+};
+
+struct profile_db_entry{
+	// nul padded, "homebrew" for titles without a disc id
+	char disc_id[PROFILE_DB_DISC_ID_SIZE];
+	// from the start of the file
+	uint32_t offset;
+	uint32_t len;
+};
+
+#define PROFILE_DB_INDEX_SIZE(entry_cnt) (sizeof(struct profile_db_header) + (entry_cnt) * sizeof(struct profile_db_entry))
+
+#endif
@@ -0,0 +1,92 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// the in memory PARAM.SFO lookup, shared by the plugin and the host tools
+
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+#include "sfo.h"
+
+// every offset is checked against len
+int sfo_find_disc_id(const unsigned char *sfo, uint32_t len, char *out_buf, uint32_t out_size){
+	if(len < SFO_HEADER_SIZE || memcmp(sfo, "\0PSF", 4) != 0){
+		LOG("sfo header is missing or invalid\n");
+		return -1;
+	}
+
+	const unsigned char *field = sfo + 0x08;
+	uint32_t key_table_start = 0;
+	CONV_LE(field, key_table_start);
+	field = sfo + 0x0C;
+	uint32_t data_table_start = 0;
+	CONV_LE(field, data_table_start);
+	field = sfo + 0x10;
+	uint32_t tables_entries = 0;
+	CONV_LE(field, tables_entries);
+	LOG_VERBOSE("key_table_start is %d, data_table_start is %d, tables_entries is %d\n", (int)key_table_start, (int)data_table_start, (int)tables_entries);
+
+	if(key_table_start > len || data_table_start > len){
+		LOG("sfo table offsets are out of bounds\n");
+		return -1;
+	}
+
+	uint32_t i;
+	for(i = 0;i < tables_entries;i++){
+		uint32_t entry_pos = SFO_HEADER_SIZE + i * SFO_ENTRY_SIZE;
+		if(i >= MAX_SFO_ENTRIES || entry_pos + SFO_ENTRY_SIZE > len){
+			break;
+		}
+		const unsigned char *entry = sfo + entry_pos;
+		uint32_t key_offset = 0;
+		CONV_LE16(entry, key_offset);
+		field = entry + 0x04;
+		uint32_t data_len = 0;
+		CONV_LE(field, data_len);
+		field = entry + 0x0C;
+		uint32_t data_offset = 0;
+		CONV_LE(field, data_offset);
+
+		// compare the terminator too so DISC_IDX would not match
+		uint32_t key_pos = key_table_start + key_offset;
+		if(key_pos > len || len - key_pos < sizeof("DISC_ID") || memcmp(sfo + key_pos, "DISC_ID", sizeof("DISC_ID")) != 0){
+			continue;
+		}
+
+		uint32_t data_pos = data_table_start + data_offset;
+		if(data_offset > len || data_pos > len || data_len > len - data_pos){
+			LOG("DISC_ID data is out of bounds\n");
+			return -1;
+		}
+		// the data length usually counts the terminator, but the id ends at the first nul either way
+		const unsigned char *data = sfo + data_pos;
+		const unsigned char *nul = memchr(data, '\0', data_len);
+		uint32_t id_len = nul != NULL ? nul - data : data_len;
+		if(id_len >= out_size){
+			LOG("DISC_ID data is too long, %d bytes\n", (int)id_len);
+			return -1;
+		}
+		memcpy(out_buf, data, id_len);
+		out_buf[id_len] = '\0';
+		return 0;
+	}
+
+	LOG("DISC_ID not found in sfo\n");
+	return -1;
+}
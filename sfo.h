@@ -0,0 +1,40 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SFO_H__
+#define __SFO_H__
+
+#include <stdint.h>
+
+#define CONV_LE(addr, dest) { \
+	dest = addr[0] | addr[1] << 8 | addr[2] << 16 | (uint32_t)addr[3] << 24; \
+}
+
+#define CONV_LE16(addr, dest) { \
+	dest = addr[0] | addr[1] << 8; \
+}
+
+#define SFO_HEADER_SIZE 0x14
+#define SFO_ENTRY_SIZE 0x10
+#define MAX_SFO_ENTRIES 32
+#define MAX_SFO_SIZE 2048
+
+// looks up DISC_ID in the first len bytes of a PARAM.SFO image, 0 and a nul terminated id in out_buf when found
+int sfo_find_disc_id(const unsigned char *sfo, uint32_t len, char *out_buf, uint32_t out_size);
+
+#endif
@@ -0,0 +1,195 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// host microbenchmark of the per sample mapping cost, the numbers are host cpu time and only meaningful relative to
+// each other, the psp's allegrex has no hardware divider fast path and a much smaller cache
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// included rather than linked, so the generic kernel below can instantiate the same loop body with runtime flags
+#include "../mapping.c"
+
+#define BATCH 64
+#define ROUNDS 200000
+
+// the per sample arithmetic the level tables replaced, kept as it was before them
+static int reference_button_on(const struct profile *p, int val, uint32_t timestamp){
+	int max_val = (127 - (int)p->outer_deadzone) - (int)p->inner_deadzone;
+	if(max_val <= 0){
+		return 0;
+	}
+	if(val < p->inner_deadzone){
+		return 0;
+	}else{
+		val = val - p->inner_deadzone;
+	}
+	if(val > max_val){
+		val = max_val;
+	}
+
+	uint32_t min_slice = p->window * p->min_percent / 100;
+	if(min_slice == 0){
+		min_slice = 1;
+	}
+	uint32_t slice = min_slice + (val * (p->window - min_slice)) / max_val;
+
+	uint32_t n = timestamp % p->window + 1;
+	switch(p->algo){
+		case ALGO_GROUP:
+			return slice >= n;
+		case ALGO_SPREAD:{
+			int odd_frames = p->window / 2 + p->window % 2;
+			int slice_odd = slice > odd_frames ? odd_frames : slice;
+			int slice_even = slice > slice_odd ? slice - slice_odd : 0;
+			if(n % 2 == 0){
+				return slice_even >= n / 2;
+			}else{
+				return slice_odd >= 1 + n / 2;
+			}
+		}
+		default:
+			return 0;
+	}
+}
+
+static void reference_apply(const struct profile *p, SceCtrlData *pad_data, int count, int negative){
+	int i;
+	for(i = 0;i < count; i++){
+		int buttons = negative ? ~pad_data[i].Buttons : pad_data[i].Buttons;
+		int rx = pad_data[i].Rsrv[0];
+		int ry = pad_data[i].Rsrv[1];
+		uint32_t timestamp = pad_data[i].TimeStamp;
+
+		if(rx > 128 && reference_button_on(p, rx - 128, timestamp))
+			buttons |= p->buttons[AXIS_XP];
+		if(rx < 128 && reference_button_on(p, rx == 0 ? 127 : 128 - rx, timestamp))
+			buttons |= p->buttons[AXIS_XN];
+		if(ry > 128 && reference_button_on(p, ry - 128, timestamp))
+			buttons |= p->buttons[AXIS_YP];
+		if(ry < 128 && reference_button_on(p, ry == 0 ? 127 : 128 - ry, timestamp))
+			buttons |= p->buttons[AXIS_YN];
+
+		pad_data[i].Buttons = negative ? ~buttons : buttons;
+	}
+}
+
+// the loop as one kernel would be with every choice made per call, the flags are read from volatiles so they are
+// not folded into constants
+static volatile int generic_x_active, generic_y_active, generic_radial, generic_sigma_delta;
+
+static void __attribute__((noinline)) map_generic(SceCtrlData *pad_data, int count, int negative){
+	mapping_kernel_body(pad_data, count, sizeof(SceCtrlData), negative ? 0xFFFFFFFF : 0, generic_x_active, generic_y_active, generic_radial, generic_sigma_delta);
+}
+
+static void set_generic_flags(){
+	generic_radial = profile.deadzone_mode != DEADZONE_AXIAL;
+	generic_sigma_delta = profile.algo == ALGO_SIGMA_DELTA;
+	generic_x_active = (profile.buttons[AXIS_XP] | profile.buttons[AXIS_XN]) != 0;
+	generic_y_active = (profile.buttons[AXIS_YP] | profile.buttons[AXIS_YN]) != 0;
+}
+
+static double now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// a sweep over the whole stick range, so every level gets hit
+static void fill_batch(SceCtrlData *batch, int count, uint32_t start){
+	int i;
+	for(i = 0;i < count;i++){
+		memset(&batch[i], 0, sizeof(batch[i]));
+		batch[i].TimeStamp = start + i;
+		batch[i].Rsrv[0] = (start + i * 7) & 0xFF;
+		batch[i].Rsrv[1] = (start + i * 13) & 0xFF;
+	}
+}
+
+enum bench_names{
+	BENCH_REFERENCE = 0,
+	BENCH_GENERIC = 1,
+	BENCH_SPECIALISED = 2
+};
+
+static double bench(int which, int count){
+	SceCtrlData batch[BATCH];
+	uint32_t sink = 0;
+	int rounds = ROUNDS * BATCH / count;
+	double start = now_ns();
+	int round;
+	for(round = 0;round < rounds;round++){
+		fill_batch(batch, count, round * count);
+		switch(which){
+			case BENCH_REFERENCE:
+				reference_apply(&profile, batch, count, 0);
+				break;
+			case BENCH_GENERIC:
+				map_generic(batch, count, 0);
+				break;
+			default:
+				apply_analog_to_digital(batch, count, 0);
+				break;
+		}
+		sink += batch[count - 1].Buttons;
+	}
+	double per_sample = (now_ns() - start) / ((double)rounds * count);
+	if(sink == 1){
+		printf("\n");
+	}
+	return per_sample;
+}
+
+static void load_config(const char *text){
+	profile_set_defaults(&profile);
+	profile_parse_text(&profile, text, strlen(text));
+	profile_build_tables(&profile);
+	reset_mapping_state();
+	select_mapping_kernel();
+}
+
+int main(){
+	// the filling of the batch is included in all of them, so the differences are the mapping itself
+	const char *configs[] = {
+		"cross square none none 8 0 group",
+		"cross square triangle circle 18 5555 spread",
+		"cross square triangle circle 18 5555 sigmadelta 0 linear radial",
+	};
+	const int batch_sizes[] = {1, 16, BATCH};
+	int i, j;
+	printf("per sample cost on %d sample batches, ns\n", BATCH);
+	for(i = 0;i < 2;i++){
+		load_config(configs[i]);
+		double reference = bench(BENCH_REFERENCE, BATCH);
+		double tables = bench(BENCH_SPECIALISED, BATCH);
+		printf("%-65s per sample arithmetic %6.2f, level tables %6.2f\n", configs[i], reference, tables);
+	}
+	printf("per sample cost of the generic and the specialised kernel, ns\n");
+	for(i = 0;i < sizeof(configs) / sizeof(configs[0]);i++){
+		load_config(configs[i]);
+		set_generic_flags();
+		for(j = 0;j < sizeof(batch_sizes) / sizeof(batch_sizes[0]);j++){
+			double generic = bench(BENCH_GENERIC, batch_sizes[j]);
+			double specialised = bench(BENCH_SPECIALISED, batch_sizes[j]);
+			printf("%-65s %2d samples, generic %6.2f, specialised %6.2f\n", configs[i], batch_sizes[j], generic, specialised);
+		}
+	}
+	return 0;
+}
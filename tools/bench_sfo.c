@@ -0,0 +1,203 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// host benchmark of the DISC_ID lookup, the per field seeks and reads it replaced against the buffered one, both over
+// the same PARAM.SFO file through plain read and lseek
+//
+// the file sits in the host's page cache, so the times are mostly syscall overhead, the call counts are what carries
+// over to a umd or memory stick where every call can be a seek
+//
+// bench_sfo [sfo file]
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sfo.h"
+
+#define ROUNDS 20000
+
+static long io_calls;
+
+static int counted_read(int fd, void *buf, int len){
+	io_calls++;
+	return read(fd, buf, len);
+}
+
+static void counted_lseek(int fd, long offset, int whence){
+	io_calls++;
+	lseek(fd, offset, whence);
+}
+
+// the lookup as it was before the buffered parser, minus its logging
+static int per_field_disc_id(const char *path, char *out_buf){
+	int fd = open(path, O_RDONLY);
+	io_calls++;
+	if(fd < 0){
+		return -1;
+	}
+
+	unsigned char buf[4];
+	counted_lseek(fd, 0x08, SEEK_SET);
+	if(counted_read(fd, buf, 4) != 4){
+		close(fd);
+		return -1;
+	}
+	uint32_t key_table_start = 0;
+	CONV_LE(buf, key_table_start);
+	if(counted_read(fd, buf, 4) != 4){
+		close(fd);
+		return -1;
+	}
+	uint32_t data_table_start = 0;
+	CONV_LE(buf, data_table_start);
+	if(counted_read(fd, buf, 4) != 4){
+		close(fd);
+		return -1;
+	}
+	uint32_t tables_entries = 0;
+	CONV_LE(buf, tables_entries);
+
+	int found = -1;
+	int i;
+	for(i = 0;i < tables_entries;i++){
+		counted_lseek(fd, 0x14 + i * 0x10, SEEK_SET);
+		uint32_t key_offset = 0, data_len = 0, data_offset = 0;
+		if(counted_read(fd, buf, 2) != 2){
+			break;
+		}
+		CONV_LE16(buf, key_offset);
+		if(counted_read(fd, buf, 2) != 2){
+			break;
+		}
+		if(counted_read(fd, buf, 4) != 4){
+			break;
+		}
+		CONV_LE(buf, data_len);
+		counted_lseek(fd, 4, SEEK_CUR);
+		if(counted_read(fd, buf, 4) != 4){
+			break;
+		}
+		CONV_LE(buf, data_offset);
+
+		counted_lseek(fd, key_offset + key_table_start, SEEK_SET);
+		char keybuf[50];
+		int j;
+		for(j = 0;j < sizeof(keybuf) - 1;j++){
+			if(counted_read(fd, &keybuf[j], 1) != 1 || keybuf[j] == 0){
+				break;
+			}
+		}
+		keybuf[j] = '\0';
+
+		counted_lseek(fd, data_offset + data_table_start, SEEK_SET);
+		char databuf[64];
+		for(j = 0;j < data_len && j < sizeof(databuf) - 1;j++){
+			if(counted_read(fd, &databuf[j], 1) != 1){
+				break;
+			}
+		}
+		databuf[j] = '\0';
+
+		if(strcmp("DISC_ID", keybuf) == 0){
+			strcpy(out_buf, databuf);
+			found = 0;
+			break;
+		}
+	}
+	close(fd);
+	io_calls++;
+	return found;
+}
+
+// the same reads get_disc_id_from_disc makes
+static int buffered_disc_id(const char *path, char *out_buf){
+	static unsigned char sfo_buf[MAX_SFO_SIZE];
+	int fd = open(path, O_RDONLY);
+	io_calls++;
+	if(fd < 0){
+		return -1;
+	}
+
+	int index_size = SFO_HEADER_SIZE + MAX_SFO_ENTRIES * SFO_ENTRY_SIZE;
+	int read_len = counted_read(fd, sfo_buf, index_size);
+	if(read_len < SFO_HEADER_SIZE){
+		close(fd);
+		return -1;
+	}
+	const unsigned char *field = sfo_buf + 0x08;
+	uint32_t key_table_start = 0;
+	CONV_LE(field, key_table_start);
+	if(key_table_start >= MAX_SFO_SIZE){
+		close(fd);
+		return -1;
+	}
+
+	int sfo_len = read_len;
+	if(key_table_start <= read_len){
+		if(read_len == index_size){
+			int tables_len = counted_read(fd, sfo_buf + read_len, MAX_SFO_SIZE - read_len);
+			if(tables_len > 0){
+				sfo_len += tables_len;
+			}
+		}
+	}else{
+		counted_lseek(fd, key_table_start, SEEK_SET);
+		int tables_len = counted_read(fd, sfo_buf + key_table_start, MAX_SFO_SIZE - key_table_start);
+		if(tables_len > 0){
+			sfo_len = key_table_start + tables_len;
+		}
+	}
+	close(fd);
+	io_calls++;
+	return sfo_find_disc_id(sfo_buf, sfo_len, out_buf, 50);
+}
+
+static double now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(const char *name, int (*lookup)(const char *path, char *out_buf), const char *path){
+	char disc_id[50] = "";
+	io_calls = 0;
+	if(lookup(path, disc_id) != 0){
+		printf("%-10s no disc id in %s\n", name, path);
+		return;
+	}
+	long calls = io_calls;
+	double start = now_ns();
+	int round;
+	for(round = 0;round < ROUNDS;round++){
+		lookup(path, disc_id);
+	}
+	double per_lookup = (now_ns() - start) / ROUNDS / 1000;
+	printf("%-10s %s, %3ld file calls, %7.2f us per lookup\n", name, disc_id, calls, per_lookup);
+}
+
+int main(int argc, char **argv){
+	const char *path = argc > 1 ? argv[1] : "corpus/sfo/valid.sfo";
+	printf("DISC_ID lookup in %s, calls include open and close\n", path);
+	bench("per field", per_field_disc_id, path);
+	bench("buffered", buffered_disc_id, path);
+	return 0;
+}
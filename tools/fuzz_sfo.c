@@ -0,0 +1,136 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// fuzz target for sfo_find_disc_id, meant to be built with address and undefined behaviour sanitizers
+//
+// built with RA2D_LIBFUZZER it is a plain libFuzzer target, otherwise it is its own driver that runs every given file
+// and a fixed number of mutations of each
+//
+// fuzz_sfo <sfo files>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sfo.h"
+#include "test.h"
+
+// the size main_thread hands over
+#define DISC_ID_SIZE 50
+#define MUTATIONS 20000
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size){
+	if(size > MAX_SFO_SIZE){
+		size = MAX_SFO_SIZE;
+	}
+	// exact size so any read past it is caught
+	unsigned char *sfo = malloc(size > 0 ? size : 1);
+	memcpy(sfo, data, size);
+
+	// one byte past the buffer handed over is a canary
+	char disc_id[DISC_ID_SIZE + 1];
+	disc_id[DISC_ID_SIZE] = 0x55;
+	if(sfo_find_disc_id(sfo, size, disc_id, DISC_ID_SIZE) == 0){
+		if(memchr(disc_id, '\0', DISC_ID_SIZE) == NULL){
+			fprintf(stderr, "disc id is not terminated\n");
+			abort();
+		}
+	}
+	if(disc_id[DISC_ID_SIZE] != 0x55){
+		fprintf(stderr, "disc id written past its buffer\n");
+		abort();
+	}
+	free(sfo);
+	return 0;
+}
+
+#ifndef RA2D_LIBFUZZER
+
+// values that sit on the edges of the bounds checks
+static uint32_t interesting_value(uint32_t *seed, uint32_t len){
+	const uint32_t values[] = {0, 1, len - 1, len, len + 1, 0x7FFF, 0xFFFF, 0x7FFFFFFF, 0x80000000, 0xFFFFFFF0, 0xFFFFFFFF};
+	return values[test_random(seed) % (sizeof(values) / sizeof(values[0]))];
+}
+
+static void mutate(unsigned char *buf, uint32_t *len, uint32_t *seed){
+	int rounds = 1 + test_random(seed) % 4;
+	while(rounds-- > 0 && *len > 0){
+		uint32_t pos = test_random(seed) % *len;
+		switch(test_random(seed) % 4){
+			case 0:
+				buf[pos] ^= 1 << (test_random(seed) % 8);
+				break;
+			case 1:
+				buf[pos] = test_random(seed);
+				break;
+			case 2:{
+				// header fields and index entries are 32 bit aligned
+				pos &= ~3;
+				if(pos + 4 <= *len){
+					uint32_t val = interesting_value(seed, *len);
+					buf[pos] = val;
+					buf[pos + 1] = val >> 8;
+					buf[pos + 2] = val >> 16;
+					buf[pos + 3] = val >> 24;
+				}
+				break;
+			}
+			default:
+				*len = pos;
+				break;
+		}
+	}
+}
+
+int main(int argc, char **argv){
+	if(argc < 2){
+		fprintf(stderr, "usage: %s <sfo files>\n", argv[0]);
+		return 2;
+	}
+	static unsigned char original[MAX_SFO_SIZE];
+	static unsigned char mutated[MAX_SFO_SIZE];
+	long runs = 0;
+	int i;
+	for(i = 1;i < argc;i++){
+		FILE *f = fopen(argv[i], "rb");
+		if(f == NULL){
+			perror(argv[i]);
+			return 1;
+		}
+		uint32_t len = fread(original, 1, sizeof(original), f);
+		fclose(f);
+
+		LLVMFuzzerTestOneInput(original, len);
+		runs++;
+
+		uint32_t seed = i;
+		int m;
+		for(m = 0;m < MUTATIONS;m++){
+			uint32_t mutated_len = len;
+			memcpy(mutated, original, len);
+			mutate(mutated, &mutated_len, &seed);
+			LLVMFuzzerTestOneInput(mutated, mutated_len);
+			runs++;
+		}
+	}
+	printf("fuzz_sfo: %ld inputs ok\n", runs);
+	return 0;
+}
+
+#endif // RA2D_LIBFUZZER
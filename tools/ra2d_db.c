@@ -0,0 +1,258 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// builds and validates the profile database the plugin reads from ms0:/PSP/ra2d_conf/profiles.db
+//
+// ra2d_db build <ra2d_conf dir> <profiles.db>
+// ra2d_db check <profiles.db>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "profile.h"
+#include "profile_db.h"
+
+#define DB_FILE_NAME "profiles.db"
+
+struct db_record{
+	char disc_id[PROFILE_DB_DISC_ID_SIZE];
+	// text config or binary profile
+	char data[PROFILE_DB_MAX_RECORD_SIZE];
+	uint32_t len;
+};
+
+static void put_le32(unsigned char *dest, uint32_t val){
+	dest[0] = val;
+	dest[1] = val >> 8;
+	dest[2] = val >> 16;
+	dest[3] = val >> 24;
+}
+
+static uint32_t get_le32(const unsigned char *src){
+	return src[0] | src[1] << 8 | src[2] << 16 | (uint32_t)src[3] << 24;
+}
+
+static int compare_profiles(const void *a, const void *b){
+	return strncmp(((const struct db_record *)a)->disc_id, ((const struct db_record *)b)->disc_id, PROFILE_DB_DISC_ID_SIZE);
+}
+
+static unsigned char *read_file(const char *path, long *len){
+	FILE *f = fopen(path, "rb");
+	if(f == NULL){
+		perror(path);
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	*len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	unsigned char *buf = malloc(*len > 0 ? *len : 1);
+	if(buf == NULL || fread(buf, 1, *len, f) != *len){
+		fprintf(stderr, "failed reading %s\n", path);
+		free(buf);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	return buf;
+}
+
+static int check_db(const char *db_path){
+	long len = 0;
+	unsigned char *buf = read_file(db_path, &len);
+	if(buf == NULL){
+		return 1;
+	}
+
+	int errors = 0;
+	uint32_t entry_cnt = 0;
+	if(len < sizeof(struct profile_db_header) || memcmp(buf, PROFILE_DB_MAGIC, 4) != 0){
+		fprintf(stderr, "%s: bad magic\n", db_path);
+		errors++;
+	}else if(get_le32(buf + 4) != PROFILE_DB_VERSION){
+		fprintf(stderr, "%s: unsupported version %u\n", db_path, get_le32(buf + 4));
+		errors++;
+	}else{
+		entry_cnt = get_le32(buf + 8);
+		if(entry_cnt > PROFILE_DB_MAX_ENTRIES){
+			fprintf(stderr, "%s: %u entries, the plugin only reads the first %d\n", db_path, entry_cnt, PROFILE_DB_MAX_ENTRIES);
+			errors++;
+		}else if(len < PROFILE_DB_INDEX_SIZE(entry_cnt)){
+			fprintf(stderr, "%s: index of %u entries is truncated\n", db_path, entry_cnt);
+			errors++;
+		}
+	}
+	if(errors != 0){
+		free(buf);
+		return 1;
+	}
+
+	int i;
+	for(i = 0;i < entry_cnt;i++){
+		const unsigned char *entry = buf + PROFILE_DB_INDEX_SIZE(i);
+		const char *disc_id = (const char *)entry;
+		uint32_t offset = get_le32(entry + PROFILE_DB_DISC_ID_SIZE);
+		uint32_t record_len = get_le32(entry + PROFILE_DB_DISC_ID_SIZE + 4);
+
+		if(memchr(disc_id, '\0', PROFILE_DB_DISC_ID_SIZE) == NULL || disc_id[0] == '\0'){
+			fprintf(stderr, "%s: entry %d has a bad disc id\n", db_path, i);
+			errors++;
+			continue;
+		}
+		if(i > 0 && strncmp(disc_id, (const char *)(entry - sizeof(struct profile_db_entry)), PROFILE_DB_DISC_ID_SIZE) <= 0){
+			fprintf(stderr, "%s: %s is out of order or duplicated\n", db_path, disc_id);
+			errors++;
+		}
+		if(offset < PROFILE_DB_INDEX_SIZE(entry_cnt) || offset > len || record_len > len - offset){
+			fprintf(stderr, "%s: record of %s is out of bounds\n", db_path, disc_id);
+			errors++;
+		}
+		if(record_len > PROFILE_DB_MAX_RECORD_SIZE){
+			fprintf(stderr, "%s: record of %s is %u bytes, more than %d\n", db_path, disc_id, record_len, PROFILE_DB_MAX_RECORD_SIZE);
+			errors++;
+		}else if(record_len <= len - offset && profile_is_binary(buf + offset, record_len)){
+			struct profile profile;
+			memcpy(&profile, buf + offset, record_len < sizeof(profile) ? record_len : sizeof(profile));
+			if(record_len != sizeof(profile) || profile_check(&profile) != 0){
+				fprintf(stderr, "%s: binary profile of %s is invalid\n", db_path, disc_id);
+				errors++;
+			}
+		}
+	}
+
+	free(buf);
+	if(errors != 0){
+		fprintf(stderr, "%s: %d errors\n", db_path, errors);
+		return 1;
+	}
+	printf("%s: %u profiles ok\n", db_path, entry_cnt);
+	return 0;
+}
+
+static int load_profile(const char *dir_path, const char *name, struct db_record *profile){
+	if(strlen(name) >= PROFILE_DB_DISC_ID_SIZE){
+		fprintf(stderr, "skipping %s, name is longer than %d characters\n", name, PROFILE_DB_DISC_ID_SIZE - 1);
+		return -1;
+	}
+
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/%s", dir_path, name);
+	struct stat st;
+	if(stat(path, &st) != 0 || !S_ISREG(st.st_mode)){
+		return -1;
+	}
+
+	long len = 0;
+	unsigned char *text = read_file(path, &len);
+	if(text == NULL){
+		return -1;
+	}
+	if(len > PROFILE_DB_MAX_RECORD_SIZE){
+		fprintf(stderr, "skipping %s, config is %ld bytes, the plugin reads at most %d\n", name, len, PROFILE_DB_MAX_RECORD_SIZE);
+		free(text);
+		return -1;
+	}
+
+	memset(profile, 0, sizeof(*profile));
+	strcpy(profile->disc_id, name);
+	memcpy(profile->data, text, len);
+	profile->len = len;
+	free(text);
+	return 0;
+}
+
+static int build_db(const char *dir_path, const char *db_path){
+	DIR *dir = opendir(dir_path);
+	if(dir == NULL){
+		perror(dir_path);
+		return 1;
+	}
+
+	struct db_record *profiles = malloc(PROFILE_DB_MAX_ENTRIES * sizeof(struct db_record));
+	if(profiles == NULL){
+		closedir(dir);
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	int profile_cnt = 0;
+	struct dirent *dirent;
+	while((dirent = readdir(dir)) != NULL){
+		if(dirent->d_name[0] == '.' || strcmp(dirent->d_name, DB_FILE_NAME) == 0){
+			continue;
+		}
+		if(profile_cnt == PROFILE_DB_MAX_ENTRIES){
+			fprintf(stderr, "more than %d profiles in %s\n", PROFILE_DB_MAX_ENTRIES, dir_path);
+			free(profiles);
+			closedir(dir);
+			return 1;
+		}
+		if(load_profile(dir_path, dirent->d_name, &profiles[profile_cnt]) == 0){
+			profile_cnt++;
+		}
+	}
+	closedir(dir);
+
+	qsort(profiles, profile_cnt, sizeof(struct db_record), compare_profiles);
+
+	FILE *f = fopen(db_path, "wb");
+	if(f == NULL){
+		perror(db_path);
+		free(profiles);
+		return 1;
+	}
+
+	unsigned char header[sizeof(struct profile_db_header)];
+	memcpy(header, PROFILE_DB_MAGIC, 4);
+	put_le32(header + 4, PROFILE_DB_VERSION);
+	put_le32(header + 8, profile_cnt);
+	fwrite(header, 1, sizeof(header), f);
+
+	uint32_t offset = PROFILE_DB_INDEX_SIZE(profile_cnt);
+	int i;
+	for(i = 0;i < profile_cnt;i++){
+		unsigned char entry[sizeof(struct profile_db_entry)];
+		memcpy(entry, profiles[i].disc_id, PROFILE_DB_DISC_ID_SIZE);
+		put_le32(entry + PROFILE_DB_DISC_ID_SIZE, offset);
+		put_le32(entry + PROFILE_DB_DISC_ID_SIZE + 4, profiles[i].len);
+		fwrite(entry, 1, sizeof(entry), f);
+		offset += profiles[i].len;
+	}
+	for(i = 0;i < profile_cnt;i++){
+		fwrite(profiles[i].data, 1, profiles[i].len, f);
+	}
+	free(profiles);
+
+	if(fclose(f) != 0){
+		perror(db_path);
+		return 1;
+	}
+	return check_db(db_path);
+}
+
+int main(int argc, char **argv){
+	if(argc == 4 && strcmp(argv[1], "build") == 0){
+		return build_db(argv[2], argv[3]);
+	}
+	if(argc == 3 && strcmp(argv[1], "check") == 0){
+		return check_db(argv[2]);
+	}
+	fprintf(stderr, "usage: %s build <ra2d_conf dir> <%s>\n       %s check <%s>\n", argv[0], DB_FILE_NAME, argv[0], DB_FILE_NAME);
+	return 2;
+}
@@ -0,0 +1,121 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// compiles text configs into the binary profiles the plugin loads without parsing or building tables
+//
+// ra2d_profile compile <text config> <binary profile>
+// ra2d_profile check <binary profile>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "profile_db.h"
+
+static int read_file(const char *path, char *buf, int size){
+	FILE *f = fopen(path, "rb");
+	if(f == NULL){
+		perror(path);
+		return -1;
+	}
+	int len = fread(buf, 1, size, f);
+	int more = fgetc(f) != EOF;
+	fclose(f);
+	if(more){
+		fprintf(stderr, "%s is larger than %d bytes\n", path, size);
+		return -1;
+	}
+	return len;
+}
+
+static int is_little_endian(){
+	uint32_t val = 1;
+	return *(unsigned char *)&val == 1;
+}
+
+static int compile_profile(const char *text_path, const char *out_path){
+	static char text[PROFILE_DB_MAX_RECORD_SIZE];
+	int len = read_file(text_path, text, sizeof(text));
+	if(len < 0){
+		return 1;
+	}
+	if(profile_is_binary(text, len)){
+		fprintf(stderr, "%s is already a binary profile\n", text_path);
+		return 1;
+	}
+
+	struct profile profile;
+	profile_set_defaults(&profile);
+	profile_parse_text(&profile, text, len);
+	profile_build_tables(&profile);
+	profile_seal(&profile);
+
+	FILE *f = fopen(out_path, "wb");
+	if(f == NULL){
+		perror(out_path);
+		return 1;
+	}
+	if(fwrite(&profile, 1, sizeof(profile), f) != sizeof(profile) || fclose(f) != 0){
+		perror(out_path);
+		return 1;
+	}
+	printf("%s: %d bytes\n", out_path, (int)sizeof(profile));
+	return 0;
+}
+
+static int check_profile(const char *path){
+	static struct profile profile;
+	int len = read_file(path, (char *)&profile, sizeof(profile));
+	if(len < 0){
+		return 1;
+	}
+	if(len != sizeof(profile)){
+		fprintf(stderr, "%s: %d bytes, a version %d profile is %d bytes\n", path, len, PROFILE_VERSION, (int)sizeof(profile));
+		return 1;
+	}
+	if(profile_check(&profile) != 0){
+		fprintf(stderr, "%s: invalid profile\n", path);
+		return 1;
+	}
+
+	// the tables are only trusted by the plugin, so make sure they are what the settings would build
+	struct profile rebuilt = profile;
+	profile_build_tables(&rebuilt);
+	if(memcmp(&rebuilt, &profile, sizeof(profile)) != 0){
+		fprintf(stderr, "%s: tables do not match the settings\n", path);
+		return 1;
+	}
+	printf("%s: ok\n", path);
+	return 0;
+}
+
+int main(int argc, char **argv){
+	if(!is_little_endian()){
+		fprintf(stderr, "binary profiles are little endian, this host is not\n");
+		return 1;
+	}
+	if(argc == 4 && strcmp(argv[1], "compile") == 0){
+		return compile_profile(argv[2], argv[3]);
+	}
+	if(argc == 3 && strcmp(argv[1], "check") == 0){
+		return check_profile(argv[2]);
+	}
+	fprintf(stderr, "usage: %s compile <text config> <binary profile>\n       %s check <binary profile>\n", argv[0], argv[0]);
+	return 2;
+}
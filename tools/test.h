@@ -0,0 +1,77 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// tiny helpers shared by the host tests, each test is its own program and exits non zero on failure
+
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mapping.h"
+#include "profile.h"
+
+static int test_failures = 0;
+
+#define CHECK(cond, ...) do{ \
+	if(!(cond)){ \
+		printf("%s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		test_failures++; \
+	} \
+}while(0)
+
+static inline int test_finish(const char *name){
+	if(test_failures != 0){
+		printf("%s: %d failures\n", name, test_failures);
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
+
+// every algo by its config name, in enum algo_names order
+static const char *const test_algos[] = {"group", "spread", "sigmadelta", "even"};
+#define TEST_ALGO_CNT (sizeof(test_algos) / sizeof(test_algos[0]))
+
+// a small lcg, so traces and mutations are the same on every host and every run
+static inline uint32_t test_random(uint32_t *seed){
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 16;
+}
+
+// loads a text config the way the plugin does, kernel selection included
+static inline void load_test_config(const char *text){
+	profile_set_defaults(&profile);
+	profile_parse_text(&profile, text, strlen(text));
+	profile_build_tables(&profile);
+	reset_mapping_state();
+	select_mapping_kernel();
+}
+
+// a sample with the right stick pushed up by val, 0 - 127, which maps to AXIS_YN
+static inline void set_stick_up(SceCtrlData *sample, uint32_t timestamp, int val){
+	memset(sample, 0, sizeof(*sample));
+	sample->TimeStamp = timestamp;
+	sample->Rsrv[0] = 128;
+	sample->Rsrv[1] = 128 - val;
+}
+
+#endif
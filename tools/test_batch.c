@@ -0,0 +1,138 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// feeds 64 sample batches, the largest sceCtrlReadBuffer* hands back, and checks that every window of the output
+// carries the duty cycle of its level, that batching does not change which samples press, and that the extended
+// reads' bigger records press the same samples without touching their extra fields
+
+#include "test.h"
+
+#define BATCH 64
+
+static const int windows[] = {1, 7, 8, 18, 32};
+
+static SceCtrlData batched[MAX_WINDOW][BATCH];
+static SceCtrlData single[MAX_WINDOW][BATCH];
+static struct ctrl_data_ext ext[MAX_WINDOW][BATCH];
+
+// window batches of 64 samples always end on a window boundary
+static void run(SceCtrlData batches[][BATCH], int window, int val, int batch_size, int negative){
+	reset_mapping_state();
+	int b, i;
+	for(b = 0;b < window;b++){
+		for(i = 0;i < BATCH;i++){
+			set_stick_up(&batches[b][i], b * BATCH + i, val);
+			if(negative){
+				batches[b][i].Buttons = ~batches[b][i].Buttons;
+			}
+		}
+		for(i = 0;i < BATCH;i += batch_size){
+			apply_analog_to_digital(&batches[b][i], batch_size, negative);
+		}
+	}
+}
+
+static int pressed(const SceCtrlData *sample, int negative){
+	uint32_t buttons = negative ? ~sample->Buttons : sample->Buttons;
+	return (buttons & profile.buttons[AXIS_YN]) != 0;
+}
+
+static void check_level(const char *algo, int window, int val, int negative){
+	uint32_t slice = profile.level_slices[val];
+	run(batched, window, val, BATCH, negative);
+	run(single, window, val, 1, negative);
+
+	int total = 0;
+	int window_presses = 0;
+	int window_mismatches = 0;
+	int batching_mismatches = 0;
+	int n;
+	for(n = 0;n < window * BATCH;n++){
+		const SceCtrlData *sample = &batched[n / BATCH][n % BATCH];
+		int on = pressed(sample, negative);
+		total += on;
+		window_presses += on;
+		if(n % window == window - 1){
+			// sigma delta carries duty across window boundaries, only its total is exact
+			if(profile.algo != ALGO_SIGMA_DELTA && window_presses != slice){
+				window_mismatches++;
+			}
+			window_presses = 0;
+		}
+		if(on != pressed(&single[n / BATCH][n % BATCH], negative)){
+			batching_mismatches++;
+		}
+		uint32_t others = (negative ? ~sample->Buttons : sample->Buttons) & ~profile.buttons[AXIS_YN];
+		CHECK(others == 0, "%s window %d level %d sample %d pressed 0x%x", algo, window, val, n, others);
+	}
+	CHECK(total == slice * BATCH, "%s window %d level %d%s pressed %d of %d samples, expected %d", algo, window, val, negative ? " negative" : "", total, window * BATCH, slice * BATCH);
+	CHECK(window_mismatches == 0, "%s window %d level %d has %d windows off slice %d", algo, window, val, window_mismatches, slice);
+	CHECK(batching_mismatches == 0, "%s window %d level %d differs in %d samples between batched and single reads", algo, window, val, batching_mismatches);
+}
+
+static void check_ext(const char *algo, int window, int val, int negative){
+	run(batched, window, val, BATCH, negative);
+
+	reset_mapping_state();
+	int b, i;
+	for(b = 0;b < window;b++){
+		for(i = 0;i < BATCH;i++){
+			set_stick_up(&ext[b][i].data, b * BATCH + i, val);
+			if(negative){
+				ext[b][i].data.Buttons = ~ext[b][i].data.Buttons;
+			}
+			memset(ext[b][i].extra, 0xA5, sizeof(ext[b][i].extra));
+		}
+		apply_analog_to_digital_ext(ext[b], BATCH, negative);
+	}
+
+	int mismatches = 0;
+	int clobbered = 0;
+	int n;
+	for(n = 0;n < window * BATCH;n++){
+		const struct ctrl_data_ext *record = &ext[n / BATCH][n % BATCH];
+		if(record->data.Buttons != batched[n / BATCH][n % BATCH].Buttons){
+			mismatches++;
+		}
+		for(i = 0;i < sizeof(record->extra) / sizeof(record->extra[0]);i++){
+			if(record->extra[i] != (int32_t)0xA5A5A5A5){
+				clobbered++;
+			}
+		}
+	}
+	CHECK(mismatches == 0, "%s window %d level %d%s differs in %d samples between plain and extended records", algo, window, val, negative ? " negative" : "", mismatches);
+	CHECK(clobbered == 0, "%s window %d level %d%s wrote %d extra fields of extended records", algo, window, val, negative ? " negative" : "", clobbered);
+}
+
+int main(){
+	int a, w, val;
+	for(a = 0;a < TEST_ALGO_CNT;a++){
+		for(w = 0;w < sizeof(windows) / sizeof(windows[0]);w++){
+			char config[128];
+			snprintf(config, sizeof(config), "cross none none none %d 0 %s", windows[w], test_algos[a]);
+			load_test_config(config);
+			for(val = 0;val < 128;val++){
+				check_level(test_algos[a], windows[w], val, 0);
+			}
+			check_level(test_algos[a], windows[w], 64, 1);
+			check_ext(test_algos[a], windows[w], 40, 0);
+			check_ext(test_algos[a], windows[w], 100, 1);
+		}
+	}
+	return test_finish("test_batch");
+}
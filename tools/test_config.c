@@ -0,0 +1,167 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// runs valid and malformed text configs through profile_parse_text and checks every resulting field, configs are
+// copied into buffers of their exact length without a terminator, the way the plugin reads them from a file
+
+#include <stdlib.h>
+
+#include "test.h"
+
+// parsed from the first field to the last, fields not reached keep the defaults
+struct config_case{
+	const char *name;
+	const char *text;
+	// 0 for strlen(text), set for texts with embedded nuls
+	int len;
+	uint32_t buttons[AXIS_CNT];
+	uint32_t window;
+	uint32_t sampling_cycle;
+	uint32_t algo;
+	uint32_t min_percent;
+	uint32_t curve;
+	uint32_t deadzone_mode;
+	uint32_t inner_deadzone;
+	uint32_t outer_deadzone;
+};
+
+#define DEFAULT_BUTTONS {PSP_CTRL_CROSS, PSP_CTRL_SQUARE, 0, 0}
+#define DEFAULT_FIELDS 8, 0, ALGO_GROUP, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20
+#define ALL_BUTTONS {PSP_CTRL_TRIANGLE, PSP_CTRL_CROSS, PSP_CTRL_SQUARE, PSP_CTRL_CIRCLE}
+
+// 50 characters, one more than the tokenizer's field buffer holds with its terminator
+#define LONG_TOKEN "01234567890123456789012345678901234567890123456789"
+// 49 characters, the longest field that fits, it reads as 18
+#define LONGEST_TOKEN "0000000000000000000000000000000000000000000000018"
+
+static const struct config_case cases[] = {
+	{"every field", "triangle cross square circle 18 5555 spread 10 expo radial 5 15\n", 0,
+		ALL_BUTTONS, 18, 5555, ALGO_SPREAD, 10, CURVE_EXPO, DEADZONE_RADIAL, 5, 15},
+	{"trailing whitespace without newline", "triangle cross square circle 16 8000 even  \t ", 0,
+		ALL_BUTTONS, 16, 8000, ALGO_EVEN, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20},
+	{"no newline", "triangle cross square circle 16 8000 even 3 scurve scaledradial 0 0", 0,
+		ALL_BUTTONS, 16, 8000, ALGO_EVEN, 3, CURVE_SCURVE, DEADZONE_SCALED_RADIAL, 0, 0},
+	{"crlf", "triangle cross\r\nsquare circle\r\n12 10000 sigmadelta\r\n20 scurve scaledradial 3 7\r\n", 0,
+		ALL_BUTTONS, 12, 10000, ALGO_SIGMA_DELTA, 20, CURVE_SCURVE, DEADZONE_SCALED_RADIAL, 3, 7},
+	{"crlf blank line ends the config", "triangle cross square circle\r\n\r\n12 10000 sigmadelta\r\n", 0,
+		ALL_BUTTONS, DEFAULT_FIELDS},
+	{"blank line ends the config", "triangle cross square circle 12\n\n10000 notes about the game\n", 0,
+		ALL_BUTTONS, 12, 0, ALGO_GROUP, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20},
+	{"long field", "triangle cross square circle " LONG_TOKEN " 5555 spread\n", 0,
+		ALL_BUTTONS, DEFAULT_FIELDS},
+	{"long field at the start", LONG_TOKEN " cross square circle 18\n", 0,
+		DEFAULT_BUTTONS, DEFAULT_FIELDS},
+	{"long field without newline", "triangle cross square circle 18 5555 spread " LONG_TOKEN, 0,
+		ALL_BUTTONS, 18, 5555, ALGO_SPREAD, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20},
+	{"longest field", "triangle cross square circle " LONGEST_TOKEN " 5555\n", 0,
+		ALL_BUTTONS, 18, 5555, ALGO_GROUP, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20},
+	{"fewer fields", "circle triangle", 0,
+		{PSP_CTRL_CIRCLE, PSP_CTRL_TRIANGLE, 0, 0}, DEFAULT_FIELDS},
+	{"required fields only", "triangle cross square circle 18 5555 spread\n", 0,
+		ALL_BUTTONS, 18, 5555, ALGO_SPREAD, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20},
+	{"extra fields", "triangle cross square circle 18 5555 spread 10 expo radial 5 15 16 20000 even\n", 0,
+		ALL_BUTTONS, 18, 5555, ALGO_SPREAD, 10, CURVE_EXPO, DEADZONE_RADIAL, 5, 15},
+	{"empty", "", 0,
+		DEFAULT_BUTTONS, DEFAULT_FIELDS},
+	{"whitespace only", " \r\n\t ", 0,
+		DEFAULT_BUTTONS, DEFAULT_FIELDS},
+	{"nul ends the config", "triangle cross\0square circle 18", 31,
+		{PSP_CTRL_TRIANGLE, PSP_CTRL_CROSS, 0, 0}, DEFAULT_FIELDS},
+	{"out of range values", "none none none none 0 5554 fast -1 101,0 diagonal 127 -1\n", 0,
+		{0, 0, 0, 0}, DEFAULT_FIELDS},
+	{"minimal input over 100 percent", "triangle cross square circle 8 0 sigmadelta 150 expo\n", 0,
+		ALL_BUTTONS, 8, 0, ALGO_SIGMA_DELTA, 0, CURVE_EXPO, DEADZONE_AXIAL, 10, 20},
+	{"window over the maximum is clamped", "triangle cross square circle 36 5555 spread\n", 0,
+		ALL_BUTTONS, MAX_WINDOW, 5555, ALGO_SPREAD, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20},
+	{"negative window", "triangle cross square circle -4 5555\n", 0,
+		ALL_BUTTONS, 8, 5555, ALGO_GROUP, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20},
+	{"boundary values", "up down left right 32 20001 group 100 0,50,100 axial 126 126\n", 0,
+		{PSP_CTRL_UP, PSP_CTRL_DOWN, PSP_CTRL_LEFT, PSP_CTRL_RIGHT}, 32, 0, ALGO_GROUP, 100, CURVE_CUSTOM, DEADZONE_AXIAL, 126, 126},
+	{"unknown buttons keep the defaults", "start select ltrigger rtrigger 32 20000\n", 0,
+		{PSP_CTRL_CROSS, PSP_CTRL_SQUARE, PSP_CTRL_LTRIGGER, PSP_CTRL_RTRIGGER}, 32, 20000, ALGO_GROUP, 0, CURVE_LINEAR, DEADZONE_AXIAL, 10, 20},
+};
+
+static void check_case(const struct config_case *c){
+	int len = c->len != 0 ? c->len : strlen(c->text);
+	// exact size so reading past len shows up under a sanitizer
+	char *buf = malloc(len > 0 ? len : 1);
+	memcpy(buf, c->text, len);
+
+	struct profile parsed;
+	profile_set_defaults(&parsed);
+	profile_parse_text(&parsed, buf, len);
+	free(buf);
+
+	int axis;
+	for(axis = 0;axis < AXIS_CNT;axis++){
+		CHECK(parsed.buttons[axis] == c->buttons[axis], "%s: button %d is 0x%x, expected 0x%x", c->name, axis, parsed.buttons[axis], c->buttons[axis]);
+	}
+	CHECK(parsed.window == c->window, "%s: window is %u, expected %u", c->name, parsed.window, c->window);
+	CHECK(parsed.sampling_cycle == c->sampling_cycle, "%s: sampling cycle is %u, expected %u", c->name, parsed.sampling_cycle, c->sampling_cycle);
+	CHECK(parsed.algo == c->algo, "%s: algo is %u, expected %u", c->name, parsed.algo, c->algo);
+	CHECK(parsed.min_percent == c->min_percent, "%s: minimal input is %u, expected %u", c->name, parsed.min_percent, c->min_percent);
+	CHECK(parsed.curve == c->curve, "%s: curve is %u, expected %u", c->name, parsed.curve, c->curve);
+	CHECK(parsed.deadzone_mode == c->deadzone_mode, "%s: deadzone mode is %u, expected %u", c->name, parsed.deadzone_mode, c->deadzone_mode);
+	CHECK(parsed.inner_deadzone == c->inner_deadzone, "%s: inner deadzone is %u, expected %u", c->name, parsed.inner_deadzone, c->inner_deadzone);
+	CHECK(parsed.outer_deadzone == c->outer_deadzone, "%s: outer deadzone is %u, expected %u", c->name, parsed.outer_deadzone, c->outer_deadzone);
+}
+
+int main(){
+	int i;
+	for(i = 0;i < sizeof(cases) / sizeof(cases[0]);i++){
+		check_case(&cases[i]);
+	}
+
+	// custom curve points are only taken from a curve that parsed whole
+	struct profile parsed;
+	profile_set_defaults(&parsed);
+	const char *curve = "cross square none none 8 0 group 0 0,25,100\n";
+	profile_parse_text(&parsed, curve, strlen(curve));
+	CHECK(parsed.curve == CURVE_CUSTOM && parsed.curve_point_cnt == 3, "custom curve parsed as %u with %u points", parsed.curve, parsed.curve_point_cnt);
+	CHECK(parsed.curve_points[0] == 0 && parsed.curve_points[1] == 25 && parsed.curve_points[2] == 100, "custom curve points are %u %u %u", parsed.curve_points[0], parsed.curve_points[1], parsed.curve_points[2]);
+	profile_set_defaults(&parsed);
+	curve = "cross square none none 8 0 group 0 0,25,101\n";
+	profile_parse_text(&parsed, curve, strlen(curve));
+	CHECK(parsed.curve == CURVE_LINEAR && parsed.curve_point_cnt == 0, "bad custom curve parsed as %u with %u points", parsed.curve, parsed.curve_point_cnt);
+
+	// every accepted minimal input keeps the slices within the window and growing with the stick
+	int min_percent;
+	for(min_percent = 0;min_percent <= 100;min_percent += 5){
+		char config[128];
+		snprintf(config, sizeof(config), "cross none none none 8 0 sigmadelta %d\n", min_percent);
+		profile_set_defaults(&parsed);
+		profile_parse_text(&parsed, config, strlen(config));
+		profile_build_tables(&parsed);
+		int val;
+		for(val = 1;val < 128;val++){
+			CHECK(parsed.level_slices[val] <= parsed.window, "minimal input %d%% level %d slice %u is over the window", min_percent, val, parsed.level_slices[val]);
+			CHECK(parsed.level_slices[val] >= parsed.level_slices[val - 1], "minimal input %d%% slice drops from %u to %u at level %d", min_percent, parsed.level_slices[val - 1], parsed.level_slices[val], val);
+		}
+	}
+
+	// compiled profiles skip the parser, so profile_check has to reject what it would not take
+	profile_set_defaults(&parsed);
+	profile_build_tables(&parsed);
+	profile_seal(&parsed);
+	CHECK(profile_check(&parsed) == 0, "default profile fails its check");
+	parsed.min_percent = 150;
+	profile_seal(&parsed);
+	CHECK(profile_check(&parsed) != 0, "profile with 150%% minimal input passes its check");
+
+	return test_finish("test_config");
+}
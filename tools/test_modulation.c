@@ -0,0 +1,139 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// step response latency and duty cycle tracking error of each algo, simulated sample by sample through the real
+// mapping kernels
+//
+// latency is the number of samples from a step off rest to the first press, over every phase the step can land on,
+// tracking error is how far the presses in the last window of samples stray from the presses the stick asked for in
+// those samples, averaged over a trace that moves the stick every few samples
+
+#include "test.h"
+
+#define WINDOW 18
+#define TRACE_LEN 20000
+#define TRACE_HOLD 23
+
+static int sample_pressed(uint32_t timestamp, int val){
+	SceCtrlData sample;
+	set_stick_up(&sample, timestamp, val);
+	apply_analog_to_digital(&sample, 1, 0);
+	return (sample.Buttons & profile.buttons[AXIS_YN]) != 0;
+}
+
+// worst and mean samples from the step to the first press, the step lands after rest samples at rest
+static void step_latency(int val, int *worst, double *mean){
+	int rest;
+	int total = 0;
+	*worst = 0;
+	for(rest = 0;rest < WINDOW;rest++){
+		reset_mapping_state();
+		uint32_t timestamp = 0;
+		int i;
+		for(i = 0;i < rest;i++){
+			sample_pressed(timestamp++, 0);
+		}
+		int latency = 0;
+		while(!sample_pressed(timestamp++, val)){
+			latency++;
+			if(latency > 2 * WINDOW){
+				break;
+			}
+		}
+		if(latency > *worst){
+			*worst = latency;
+		}
+		total += latency;
+	}
+	*mean = (double)total / WINDOW;
+}
+
+static double tracking_error(){
+	reset_mapping_state();
+	uint32_t seed = 1;
+	int val = 0;
+	int presses[WINDOW] = {0};
+	int slices[WINDOW] = {0};
+	// expected presses are kept in 1/WINDOW presses so they stay exact
+	int window_presses = 0;
+	int window_expected = 0;
+	double error_sum = 0;
+	int i;
+	for(i = 0;i < TRACE_LEN;i++){
+		if(i % TRACE_HOLD == 0){
+			val = test_random(&seed) % 128;
+		}
+		int slot = i % WINDOW;
+		window_presses -= presses[slot];
+		window_expected -= slices[slot];
+		presses[slot] = sample_pressed(i, val);
+		slices[slot] = profile.level_slices[val];
+		window_presses += presses[slot];
+		window_expected += slices[slot];
+		if(i >= WINDOW){
+			int diff = window_presses * WINDOW - window_expected;
+			error_sum += (double)(diff < 0 ? -diff : diff) / WINDOW;
+		}
+	}
+	return error_sum / (TRACE_LEN - WINDOW);
+}
+
+int main(){
+	double errors[TEST_ALGO_CNT];
+	int a;
+	printf("window %d, latency in samples from rest, tracking error in presses\n", WINDOW);
+	for(a = 0;a < TEST_ALGO_CNT;a++){
+		char config[128];
+		snprintf(config, sizeof(config), "cross none none none %d 0 %s 0", WINDOW, test_algos[a]);
+		load_test_config(config);
+
+		int worst_latency = 0;
+		double mean_latency_sum = 0;
+		int levels = 0;
+		int val;
+		for(val = 1;val < 128;val++){
+			if(profile.level_slices[val] == 0){
+				continue;
+			}
+			int worst;
+			double mean;
+			step_latency(val, &worst, &mean);
+			CHECK(worst < WINDOW, "%s level %d took %d samples to press", test_algos[a], val, worst);
+			if(profile.algo == ALGO_SIGMA_DELTA){
+				CHECK(worst == 0, "sigmadelta level %d took %d samples to press", val, worst);
+			}
+			if(worst > worst_latency){
+				worst_latency = worst;
+			}
+			mean_latency_sum += mean;
+			levels++;
+		}
+		CHECK(levels > 0, "%s has no pressing level", test_algos[a]);
+
+		errors[a] = tracking_error();
+		printf("%-10s latency worst %2d mean %5.2f, tracking error %5.2f\n", test_algos[a], worst_latency, levels > 0 ? mean_latency_sum / levels : 0, errors[a]);
+		if(profile.algo == ALGO_SIGMA_DELTA){
+			// the accumulator never holds more than a window's worth of unspent duty
+			CHECK(errors[a] < 1, "sigmadelta tracking error %.2f", errors[a]);
+		}
+	}
+	for(a = 0;a < TEST_ALGO_CNT;a++){
+		CHECK(errors[ALGO_SIGMA_DELTA] <= errors[a], "sigmadelta tracks worse than %s, %.2f vs %.2f", test_algos[a], errors[ALGO_SIGMA_DELTA], errors[a]);
+	}
+	return test_finish("test_modulation");
+}
@@ -0,0 +1,134 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// the radial deadzone modes, stick positions are fed one sample at a time from a fresh phase, so a sample presses a
+// direction exactly when that direction's level has a non zero slice
+//
+// drift anywhere inside the inner circle must not press, pushing along one axis must not press the other axis, and
+// pressing must start where the deadzone ends
+
+#include <stdlib.h>
+
+#include "test.h"
+
+static const char *modes[] = {"radial", "scaledradial"};
+static const int inner_deadzones[] = {0, 5, 10, 13, 20, 30, 45};
+
+// buttons pressed with the right stick at x, y, -128 - 127 each, up being negative y
+static uint32_t stick_buttons(int x, int y){
+	SceCtrlData sample;
+	memset(&sample, 0, sizeof(sample));
+	sample.Rsrv[0] = 128 + x;
+	sample.Rsrv[1] = 128 + y;
+	reset_mapping_state();
+	apply_analog_to_digital(&sample, 1, 0);
+	return sample.Buttons;
+}
+
+// up, down, left, right
+static const int directions[AXIS_CNT][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+static const enum axis_names direction_axes[AXIS_CNT] = {AXIS_YN, AXIS_YP, AXIS_XN, AXIS_XP};
+
+static void check_inner_circle(const char *mode, int inner){
+	int x, y;
+	for(y = -inner;y <= inner;y++){
+		for(x = -inner;x <= inner;x++){
+			if(x * x + y * y >= inner * inner){
+				continue;
+			}
+			uint32_t buttons = stick_buttons(x, y);
+			CHECK(buttons == 0, "%s inner %d drift at %d, %d pressed 0x%x", mode, inner, x, y, buttons);
+		}
+	}
+}
+
+static void check_orthogonal_leak(const char *mode, int inner){
+	int d, val, drift;
+	for(d = 0;d < AXIS_CNT;d++){
+		uint32_t own = profile.buttons[direction_axes[d]];
+		for(val = 0;val <= 127;val++){
+			for(drift = -(RADIAL_AXIS_FLOOR - 1);drift < RADIAL_AXIS_FLOOR;drift++){
+				// drift runs along the other axis
+				int x = directions[d][0] * val + directions[d][1] * drift;
+				int y = directions[d][1] * val + directions[d][0] * drift;
+				uint32_t others = stick_buttons(x, y) & ~own;
+				CHECK(others == 0, "%s inner %d pushing %d along direction %d with %d of drift pressed 0x%x", mode, inner, val, d, drift, others);
+			}
+		}
+	}
+}
+
+static void check_press_start(const char *mode, int inner){
+	int d, val;
+	int expected = inner > RADIAL_AXIS_FLOOR ? inner : RADIAL_AXIS_FLOOR;
+	for(d = 0;d < AXIS_CNT;d++){
+		uint32_t own = profile.buttons[direction_axes[d]];
+		int first = -1;
+		for(val = 0;val <= 127;val++){
+			int on = (stick_buttons(directions[d][0] * val, directions[d][1] * val) & own) != 0;
+			if(first < 0 && on){
+				first = val;
+			}
+			// once pressing, every further push presses too
+			CHECK(first < 0 || on, "%s inner %d direction %d stops pressing at %d after starting at %d", mode, inner, d, val, first);
+		}
+		CHECK(first == expected, "%s inner %d direction %d first presses at %d, expected %d", mode, inner, d, first, expected);
+	}
+
+	// along a diagonal both buttons start together, within a unit of the edge of the inner deadzone in plain radial mode,
+	// scaled radial splits the first unit of scaled magnitude across both axes so it can take a few more
+	int first_sq = -1;
+	for(val = 0;val <= 127 && first_sq < 0;val++){
+		uint32_t buttons = stick_buttons(val, -val);
+		if(buttons != 0){
+			CHECK(buttons == (profile.buttons[AXIS_XP] | profile.buttons[AXIS_YN]), "%s inner %d diagonal %d pressed 0x%x", mode, inner, val, buttons);
+			first_sq = 2 * val * val;
+		}
+	}
+	int slack = profile.deadzone_mode == DEADZONE_SCALED_RADIAL ? 4 : 2;
+	CHECK(first_sq >= inner * inner && (first_sq < (inner + slack) * (inner + slack) || first_sq <= 2 * RADIAL_AXIS_FLOOR * RADIAL_AXIS_FLOOR),
+		"%s inner %d diagonal first presses at magnitude squared %d", mode, inner, first_sq);
+}
+
+static void check_full_deflection(const char *mode, int inner){
+	int d;
+	for(d = 0;d < AXIS_CNT;d++){
+		int x = directions[d][0] * 127;
+		int y = directions[d][1] * 127;
+		int val = profile.level_slices[127];
+		CHECK(val == profile.window, "%s inner %d full deflection slice is %d of %u", mode, inner, val, profile.window);
+		uint32_t buttons = stick_buttons(x, y);
+		CHECK(buttons == profile.buttons[direction_axes[d]], "%s inner %d full deflection along direction %d pressed 0x%x", mode, inner, d, buttons);
+	}
+}
+
+int main(){
+	int m, i;
+	for(m = 0;m < sizeof(modes) / sizeof(modes[0]);m++){
+		for(i = 0;i < sizeof(inner_deadzones) / sizeof(inner_deadzones[0]);i++){
+			char config[128];
+			snprintf(config, sizeof(config), "triangle cross square circle 8 0 group 0 linear %s %d 20", modes[m], inner_deadzones[i]);
+			load_test_config(config);
+			check_inner_circle(modes[m], inner_deadzones[i]);
+			check_orthogonal_leak(modes[m], inner_deadzones[i]);
+			check_press_start(modes[m], inner_deadzones[i]);
+			check_full_deflection(modes[m], inner_deadzones[i]);
+		}
+	}
+	return test_finish("test_radial");
+}
@@ -0,0 +1,110 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// sweeps the sampling cycle from 5555 to 20000 microseconds with jittered timestamps and uneven read sizes, the
+// presses must land on the same samples at every rate, and every window of samples must carry its level's duty cycle
+
+#include <stdlib.h>
+
+#include "test.h"
+
+#define WINDOW 18
+#define SAMPLES (WINDOW * 64)
+#define CYCLE_MIN 5555
+#define CYCLE_MAX 20000
+#define CYCLE_STEP 17
+#define JITTER 200
+
+static const int levels[] = {0, 10, 11, 40, 64, 90, 126, 127};
+
+static uint8_t reference[sizeof(levels) / sizeof(levels[0])][SAMPLES];
+static uint8_t presses[SAMPLES];
+
+// the stick is held at val, reads come back 1 to 16 samples at a time
+static void run(int cycle, int val, uint32_t seed){
+	SceCtrlData batch[16];
+	uint32_t timestamp = test_random(&seed);
+	reset_mapping_state();
+	int n = 0;
+	while(n < SAMPLES){
+		int count = 1 + test_random(&seed) % 16;
+		if(count > SAMPLES - n){
+			count = SAMPLES - n;
+		}
+		int i;
+		for(i = 0;i < count;i++){
+			timestamp += cycle - JITTER + test_random(&seed) % (2 * JITTER + 1);
+			set_stick_up(&batch[i], timestamp, val);
+		}
+		apply_analog_to_digital(batch, count, 0);
+		for(i = 0;i < count;i++){
+			presses[n + i] = (batch[i].Buttons & profile.buttons[AXIS_YN]) != 0;
+		}
+		n += count;
+	}
+}
+
+static void check_duty(const char *algo, int cycle, int val){
+	uint32_t slice = profile.level_slices[val];
+	int total = 0;
+	int window_presses = 0;
+	int n;
+	for(n = 0;n < SAMPLES;n++){
+		total += presses[n];
+		window_presses += presses[n];
+		if(n % WINDOW == WINDOW - 1){
+			if(profile.algo != ALGO_SIGMA_DELTA){
+				CHECK(window_presses == slice, "%s cycle %d level %d pressed %d in window ending at sample %d, expected %d", algo, cycle, val, window_presses, n, slice);
+			}
+			window_presses = 0;
+		}
+	}
+	CHECK(total * WINDOW == slice * SAMPLES, "%s cycle %d level %d pressed %d of %d samples, expected %d", algo, cycle, val, total, SAMPLES, slice * SAMPLES / WINDOW);
+}
+
+int main(){
+	int a, l, step;
+	int rates = 0;
+	for(a = 0;a < TEST_ALGO_CNT;a++){
+		// the last step is clamped so both ends of the range are covered
+		for(step = 0;step == 0 || CYCLE_MIN + (step - 1) * CYCLE_STEP < CYCLE_MAX;step++){
+			int cycle = CYCLE_MIN + step * CYCLE_STEP;
+			if(cycle > CYCLE_MAX){
+				cycle = CYCLE_MAX;
+			}
+			char config[128];
+			snprintf(config, sizeof(config), "cross none none none %d %d %s", WINDOW, cycle, test_algos[a]);
+			load_test_config(config);
+			CHECK(profile.sampling_cycle == cycle, "sampling cycle %d parsed as %u", cycle, profile.sampling_cycle);
+			for(l = 0;l < sizeof(levels) / sizeof(levels[0]);l++){
+				run(cycle, levels[l], cycle * 31 + l);
+				check_duty(test_algos[a], cycle, levels[l]);
+				if(cycle == CYCLE_MIN){
+					memcpy(reference[l], presses, SAMPLES);
+				}else{
+					CHECK(memcmp(reference[l], presses, SAMPLES) == 0, "%s cycle %d level %d presses on different samples than at %d", test_algos[a], cycle, levels[l], CYCLE_MIN);
+				}
+			}
+			if(a == 0){
+				rates++;
+			}
+		}
+	}
+	printf("%d sampling cycles from %d to %d microseconds\n", rates, CYCLE_MIN, CYCLE_MAX);
+	return test_finish("test_sampling_rate");
+}
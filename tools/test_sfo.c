@@ -0,0 +1,124 @@
+/*
+  Remastered Controls: analog to digital
+  Copyright (C) 2023, Katharine Chui
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// runs the PARAM.SFO corpus through sfo_find_disc_id and checks which ids come out, every file is loaded into a buffer
+// of its exact size
+
+#include <stdlib.h>
+
+#include "sfo.h"
+#include "test.h"
+
+#define CORPUS_DIR "corpus/sfo/"
+// the size main_thread hands over
+#define DISC_ID_SIZE 50
+
+struct sfo_case{
+	const char *file;
+	// NULL when the lookup has to fail
+	const char *disc_id;
+};
+
+static const struct sfo_case cases[] = {
+	{"valid.sfo", "ULUS10041"},
+	{"empty.sfo", NULL},
+	{"bad_magic.sfo", NULL},
+	{"truncated_header.sfo", NULL},
+	// the index ends before the DISC_ID entry
+	{"truncated_index.sfo", NULL},
+	// only the entries inside the file are read
+	{"index_count_past_len.sfo", "ULUS10041"},
+	{"index_count_huge.sfo", "ULUS10041"},
+	{"key_table_out_of_range.sfo", NULL},
+	{"data_table_out_of_range.sfo", NULL},
+	// the DISC_ID key cannot be found through an out of range key offset
+	{"key_offset_out_of_range.sfo", NULL},
+	{"data_offset_out_of_range.sfo", NULL},
+	{"data_len_out_of_range.sfo", NULL},
+	{"disc_id_unterminated.sfo", "ULUS10041"},
+	{"disc_id_unterminated_at_end.sfo", "NPJH50001"},
+	// the file ends on the key without its terminator
+	{"disc_id_key_unterminated.sfo", NULL},
+	{"disc_id_too_long.sfo", NULL},
+	{"disc_idx_key.sfo", NULL},
+};
+
+static unsigned char *read_corpus_file(const char *name, long *len){
+	char path[256];
+	snprintf(path, sizeof(path), CORPUS_DIR "%s", name);
+	FILE *f = fopen(path, "rb");
+	if(f == NULL){
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	*len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	unsigned char *buf = malloc(*len > 0 ? *len : 1);
+	if(buf != NULL && fread(buf, 1, *len, f) != *len){
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	return buf;
+}
+
+static void check_case(const struct sfo_case *c){
+	long len = 0;
+	unsigned char *sfo = read_corpus_file(c->file, &len);
+	CHECK(sfo != NULL, "cannot read %s", c->file);
+	if(sfo == NULL){
+		return;
+	}
+
+	char disc_id[DISC_ID_SIZE];
+	memset(disc_id, 0x55, sizeof(disc_id));
+	int res = sfo_find_disc_id(sfo, len, disc_id, sizeof(disc_id));
+	if(c->disc_id == NULL){
+		CHECK(res != 0, "%s: found %.*s, expected no disc id", c->file, DISC_ID_SIZE, disc_id);
+	}else{
+		CHECK(res == 0, "%s: no disc id, expected %s", c->file, c->disc_id);
+		CHECK(res != 0 || strcmp(disc_id, c->disc_id) == 0, "%s: found %.*s, expected %s", c->file, DISC_ID_SIZE, disc_id, c->disc_id);
+	}
+
+	// a disc id has to fit with its terminator
+	if(c->disc_id != NULL){
+		int id_len = strlen(c->disc_id);
+		CHECK(sfo_find_disc_id(sfo, len, disc_id, id_len + 1) == 0, "%s: no disc id with a %d byte buffer", c->file, id_len + 1);
+		CHECK(sfo_find_disc_id(sfo, len, disc_id, id_len) != 0, "%s: disc id written into a %d byte buffer", c->file, id_len);
+	}
+
+	// no truncation of a file may turn up an id the whole file does not have
+	long cut;
+	for(cut = 0;cut < len;cut++){
+		unsigned char *truncated = malloc(cut > 0 ? cut : 1);
+		memcpy(truncated, sfo, cut);
+		if(sfo_find_disc_id(truncated, cut, disc_id, sizeof(disc_id)) == 0){
+			CHECK(c->disc_id != NULL && strcmp(disc_id, c->disc_id) == 0, "%s: cut to %ld bytes found %s", c->file, cut, disc_id);
+		}
+		free(truncated);
+	}
+	free(sfo);
+}
+
+int main(){
+	int i;
+	for(i = 0;i < sizeof(cases) / sizeof(cases[0]);i++){
+		check_case(&cases[i]);
+	}
+	return test_finish("test_sfo");
+}